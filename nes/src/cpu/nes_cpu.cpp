@@ -1,6 +1,249 @@
 #include "nes_cpu.h"
 
 namespace NES_Emulator {
+  // Opcode table
+  constexpr BYTE NES_CPU::get_address_mode_length(nes_addr_mode addr_mode) {
+    switch (addr_mode) {
+      case nes_addr_mode_imp:
+      case nes_addr_mode_acc:
+        return 1;
+      case nes_addr_mode_abs:
+      case nes_addr_mode_abs_jmp:
+      case nes_addr_mode_abs_x:
+      case nes_addr_mode_abs_y:
+      case nes_addr_mode_ind_jmp:
+        return 3;
+      default:
+        return 2;
+    }
+  }
+
+  constexpr std::array<NES_CPU::opcode_info, 256> NES_CPU::build_opcode_table() {
+    std::array<opcode_info, 256> table = {};
+
+    // Unofficial opcodes run as a two cycle NOP.
+    for (opcode_info &info : table)
+      info = {&NES_CPU::NOP, nes_addr_mode_imp, 2, 1, false};
+
+    auto op = [&table](opcode_t code, instruction handler, nes_addr_mode addr_mode, cycle_t cycles, bool page_penalty = false) {
+      table[code] = {handler, addr_mode, cycles, get_address_mode_length(addr_mode), page_penalty};
+    };
+
+    // ADC
+    op(0x69, &NES_CPU::ADC<nes_addr_mode_imm>,            nes_addr_mode_imm,       2);
+    op(0x65, &NES_CPU::ADC<nes_addr_mode_zp>,             nes_addr_mode_zp,        3);
+    op(0x75, &NES_CPU::ADC<nes_addr_mode_zp_x>,           nes_addr_mode_zp_x,      4);
+    op(0x6D, &NES_CPU::ADC<nes_addr_mode_abs>,            nes_addr_mode_abs,       4);
+    op(0x7D, &NES_CPU::ADC<nes_addr_mode_abs_x>,          nes_addr_mode_abs_x,     4, 1);
+    op(0x79, &NES_CPU::ADC<nes_addr_mode_abs_y>,          nes_addr_mode_abs_y,     4, 1);
+    op(0x61, &NES_CPU::ADC<nes_addr_mode_zp_ind_x>,       nes_addr_mode_zp_ind_x,  6);
+    op(0x71, &NES_CPU::ADC<nes_addr_mode_zp_ind_y>,       nes_addr_mode_zp_ind_y,  5, 1);
+    // AND
+    op(0x29, &NES_CPU::AND<nes_addr_mode_imm>,            nes_addr_mode_imm,       2);
+    op(0x25, &NES_CPU::AND<nes_addr_mode_zp>,             nes_addr_mode_zp,        3);
+    op(0x35, &NES_CPU::AND<nes_addr_mode_zp_x>,           nes_addr_mode_zp_x,      4);
+    op(0x2D, &NES_CPU::AND<nes_addr_mode_abs>,            nes_addr_mode_abs,       4);
+    op(0x3D, &NES_CPU::AND<nes_addr_mode_abs_x>,          nes_addr_mode_abs_x,     4, 1);
+    op(0x39, &NES_CPU::AND<nes_addr_mode_abs_y>,          nes_addr_mode_abs_y,     4, 1);
+    op(0x21, &NES_CPU::AND<nes_addr_mode_zp_ind_x>,       nes_addr_mode_zp_ind_x,  6);
+    op(0x31, &NES_CPU::AND<nes_addr_mode_zp_ind_y>,       nes_addr_mode_zp_ind_y,  5, 1);
+    // ASL
+    op(0x0A, &NES_CPU::ASL<nes_addr_mode_acc>,            nes_addr_mode_acc,       2);
+    op(0x06, &NES_CPU::ASL<nes_addr_mode_zp>,             nes_addr_mode_zp,        5);
+    op(0x16, &NES_CPU::ASL<nes_addr_mode_zp_x>,           nes_addr_mode_zp_x,      6);
+    op(0x0E, &NES_CPU::ASL<nes_addr_mode_abs>,            nes_addr_mode_abs,       6);
+    op(0x1E, &NES_CPU::ASL<nes_addr_mode_abs_x>,          nes_addr_mode_abs_x,     7);
+    // Branches
+    op(0x90, &NES_CPU::BCC,                               nes_addr_mode_rel,       2);
+    op(0xB0, &NES_CPU::BCS,                               nes_addr_mode_rel,       2);
+    op(0xF0, &NES_CPU::BEQ,                               nes_addr_mode_rel,       2);
+    op(0x30, &NES_CPU::BMI,                               nes_addr_mode_rel,       2);
+    op(0xD0, &NES_CPU::BNE,                               nes_addr_mode_rel,       2);
+    op(0x10, &NES_CPU::BPL,                               nes_addr_mode_rel,       2);
+    op(0x50, &NES_CPU::BVC,                               nes_addr_mode_rel,       2);
+    op(0x70, &NES_CPU::BVS,                               nes_addr_mode_rel,       2);
+    // BIT
+    op(0x24, &NES_CPU::BIT<nes_addr_mode_zp>,             nes_addr_mode_zp,        3);
+    op(0x2C, &NES_CPU::BIT<nes_addr_mode_abs>,            nes_addr_mode_abs,       4);
+    // BRK
+    op(0x00, &NES_CPU::BRK,                               nes_addr_mode_imp,       7);
+    // Flag instructions
+    op(0x18, &NES_CPU::CLC,                               nes_addr_mode_imp,       2);
+    op(0xD8, &NES_CPU::CLD,                               nes_addr_mode_imp,       2);
+    op(0x58, &NES_CPU::CLI,                               nes_addr_mode_imp,       2);
+    op(0xB8, &NES_CPU::CLV,                               nes_addr_mode_imp,       2);
+    op(0x38, &NES_CPU::SEC,                               nes_addr_mode_imp,       2);
+    op(0xF8, &NES_CPU::SED,                               nes_addr_mode_imp,       2);
+    op(0x78, &NES_CPU::SEI,                               nes_addr_mode_imp,       2);
+    // CMP
+    op(0xC9, &NES_CPU::CMP<nes_addr_mode_imm>,            nes_addr_mode_imm,       2);
+    op(0xC5, &NES_CPU::CMP<nes_addr_mode_zp>,             nes_addr_mode_zp,        3);
+    op(0xD5, &NES_CPU::CMP<nes_addr_mode_zp_x>,           nes_addr_mode_zp_x,      4);
+    op(0xCD, &NES_CPU::CMP<nes_addr_mode_abs>,            nes_addr_mode_abs,       4);
+    op(0xDD, &NES_CPU::CMP<nes_addr_mode_abs_x>,          nes_addr_mode_abs_x,     4, 1);
+    op(0xD9, &NES_CPU::CMP<nes_addr_mode_abs_y>,          nes_addr_mode_abs_y,     4, 1);
+    op(0xC1, &NES_CPU::CMP<nes_addr_mode_zp_ind_x>,       nes_addr_mode_zp_ind_x,  6);
+    op(0xD1, &NES_CPU::CMP<nes_addr_mode_zp_ind_y>,       nes_addr_mode_zp_ind_y,  5, 1);
+    // CPX
+    op(0xE0, &NES_CPU::CPX<nes_addr_mode_imm>,            nes_addr_mode_imm,       2);
+    op(0xE4, &NES_CPU::CPX<nes_addr_mode_zp>,             nes_addr_mode_zp,        3);
+    op(0xEC, &NES_CPU::CPX<nes_addr_mode_abs>,            nes_addr_mode_abs,       4);
+    // CPY
+    op(0xC0, &NES_CPU::CPY<nes_addr_mode_imm>,            nes_addr_mode_imm,       2);
+    op(0xC4, &NES_CPU::CPY<nes_addr_mode_zp>,             nes_addr_mode_zp,        3);
+    op(0xCC, &NES_CPU::CPY<nes_addr_mode_abs>,            nes_addr_mode_abs,       4);
+    // DEC
+    op(0xC6, &NES_CPU::DEC<nes_addr_mode_zp>,             nes_addr_mode_zp,        5);
+    op(0xD6, &NES_CPU::DEC<nes_addr_mode_zp_x>,           nes_addr_mode_zp_x,      6);
+    op(0xCE, &NES_CPU::DEC<nes_addr_mode_abs>,            nes_addr_mode_abs,       6);
+    op(0xDE, &NES_CPU::DEC<nes_addr_mode_abs_x>,          nes_addr_mode_abs_x,     7);
+    // DEX, DEY
+    op(0xCA, &NES_CPU::DEX,                               nes_addr_mode_imp,       2);
+    op(0x88, &NES_CPU::DEY,                               nes_addr_mode_imp,       2);
+    // EOR
+    op(0x49, &NES_CPU::EOR<nes_addr_mode_imm>,            nes_addr_mode_imm,       2);
+    op(0x45, &NES_CPU::EOR<nes_addr_mode_zp>,             nes_addr_mode_zp,        3);
+    op(0x55, &NES_CPU::EOR<nes_addr_mode_zp_x>,           nes_addr_mode_zp_x,      4);
+    op(0x4D, &NES_CPU::EOR<nes_addr_mode_abs>,            nes_addr_mode_abs,       4);
+    op(0x5D, &NES_CPU::EOR<nes_addr_mode_abs_x>,          nes_addr_mode_abs_x,     4, 1);
+    op(0x59, &NES_CPU::EOR<nes_addr_mode_abs_y>,          nes_addr_mode_abs_y,     4, 1);
+    op(0x41, &NES_CPU::EOR<nes_addr_mode_zp_ind_x>,       nes_addr_mode_zp_ind_x,  6);
+    op(0x51, &NES_CPU::EOR<nes_addr_mode_zp_ind_y>,       nes_addr_mode_zp_ind_y,  5, 1);
+    // INC
+    op(0xE6, &NES_CPU::INC<nes_addr_mode_zp>,             nes_addr_mode_zp,        5);
+    op(0xF6, &NES_CPU::INC<nes_addr_mode_zp_x>,           nes_addr_mode_zp_x,      6);
+    op(0xEE, &NES_CPU::INC<nes_addr_mode_abs>,            nes_addr_mode_abs,       6);
+    op(0xFE, &NES_CPU::INC<nes_addr_mode_abs_x>,          nes_addr_mode_abs_x,     7);
+    // INX, INY
+    op(0xE8, &NES_CPU::INX,                               nes_addr_mode_imp,       2);
+    op(0xC8, &NES_CPU::INY,                               nes_addr_mode_imp,       2);
+    // JMP, JSR
+    op(0x4C, &NES_CPU::JMP<nes_addr_mode_abs>,            nes_addr_mode_abs,       3);
+    op(0x6C, &NES_CPU::JMP<nes_addr_mode_ind_jmp>,        nes_addr_mode_ind_jmp,   5);
+    op(0x20, &NES_CPU::JSR,                               nes_addr_mode_abs_jmp,   6);
+    // LDA
+    op(0xA9, &NES_CPU::LDA<nes_addr_mode_imm>,            nes_addr_mode_imm,       2);
+    op(0xA5, &NES_CPU::LDA<nes_addr_mode_zp>,             nes_addr_mode_zp,        3);
+    op(0xB5, &NES_CPU::LDA<nes_addr_mode_zp_x>,           nes_addr_mode_zp_x,      4);
+    op(0xAD, &NES_CPU::LDA<nes_addr_mode_abs>,            nes_addr_mode_abs,       4);
+    op(0xBD, &NES_CPU::LDA<nes_addr_mode_abs_x>,          nes_addr_mode_abs_x,     4, 1);
+    op(0xB9, &NES_CPU::LDA<nes_addr_mode_abs_y>,          nes_addr_mode_abs_y,     4, 1);
+    op(0xA1, &NES_CPU::LDA<nes_addr_mode_zp_ind_x>,       nes_addr_mode_zp_ind_x,  6);
+    op(0xB1, &NES_CPU::LDA<nes_addr_mode_zp_ind_y>,       nes_addr_mode_zp_ind_y,  5, 1);
+    // LDX
+    op(0xA2, &NES_CPU::LDX<nes_addr_mode_imm>,            nes_addr_mode_imm,       2);
+    op(0xA6, &NES_CPU::LDX<nes_addr_mode_zp>,             nes_addr_mode_zp,        3);
+    op(0xB6, &NES_CPU::LDX<nes_addr_mode_zp_y>,           nes_addr_mode_zp_y,      4);
+    op(0xAE, &NES_CPU::LDX<nes_addr_mode_abs>,            nes_addr_mode_abs,       4);
+    op(0xBE, &NES_CPU::LDX<nes_addr_mode_abs_y>,          nes_addr_mode_abs_y,     4, 1);
+    // LDY
+    op(0xA0, &NES_CPU::LDY<nes_addr_mode_imm>,            nes_addr_mode_imm,       2);
+    op(0xA4, &NES_CPU::LDY<nes_addr_mode_zp>,             nes_addr_mode_zp,        3);
+    op(0xB4, &NES_CPU::LDY<nes_addr_mode_zp_x>,           nes_addr_mode_zp_x,      4);
+    op(0xAC, &NES_CPU::LDY<nes_addr_mode_abs>,            nes_addr_mode_abs,       4);
+    op(0xBC, &NES_CPU::LDY<nes_addr_mode_abs_x>,          nes_addr_mode_abs_x,     4, 1);
+    // LSR
+    op(0x4A, &NES_CPU::LSR<nes_addr_mode_acc>,            nes_addr_mode_acc,       2);
+    op(0x46, &NES_CPU::LSR<nes_addr_mode_zp>,             nes_addr_mode_zp,        5);
+    op(0x56, &NES_CPU::LSR<nes_addr_mode_zp_x>,           nes_addr_mode_zp_x,      6);
+    op(0x4E, &NES_CPU::LSR<nes_addr_mode_abs>,            nes_addr_mode_abs,       6);
+    op(0x5E, &NES_CPU::LSR<nes_addr_mode_abs_x>,          nes_addr_mode_abs_x,     7);
+    // NOP
+    op(0xEA, &NES_CPU::NOP,                               nes_addr_mode_imp,       2);
+    // ORA
+    op(0x09, &NES_CPU::ORA<nes_addr_mode_imm>,            nes_addr_mode_imm,       2);
+    op(0x05, &NES_CPU::ORA<nes_addr_mode_zp>,             nes_addr_mode_zp,        3);
+    op(0x15, &NES_CPU::ORA<nes_addr_mode_zp_x>,           nes_addr_mode_zp_x,      4);
+    op(0x0D, &NES_CPU::ORA<nes_addr_mode_abs>,            nes_addr_mode_abs,       4);
+    op(0x1D, &NES_CPU::ORA<nes_addr_mode_abs_x>,          nes_addr_mode_abs_x,     4, 1);
+    op(0x19, &NES_CPU::ORA<nes_addr_mode_abs_y>,          nes_addr_mode_abs_y,     4, 1);
+    op(0x01, &NES_CPU::ORA<nes_addr_mode_zp_ind_x>,       nes_addr_mode_zp_ind_x,  6);
+    op(0x11, &NES_CPU::ORA<nes_addr_mode_zp_ind_y>,       nes_addr_mode_zp_ind_y,  5, 1);
+    // Stack
+    op(0x48, &NES_CPU::PHA,                               nes_addr_mode_imp,       3);
+    op(0x08, &NES_CPU::PHP,                               nes_addr_mode_imp,       3);
+    op(0x68, &NES_CPU::PLA,                               nes_addr_mode_imp,       4);
+    op(0x28, &NES_CPU::PLP,                               nes_addr_mode_imp,       4);
+    // ROL
+    op(0x2A, &NES_CPU::ROL<nes_addr_mode_acc>,            nes_addr_mode_acc,       2);
+    op(0x26, &NES_CPU::ROL<nes_addr_mode_zp>,             nes_addr_mode_zp,        5);
+    op(0x36, &NES_CPU::ROL<nes_addr_mode_zp_x>,           nes_addr_mode_zp_x,      6);
+    op(0x2E, &NES_CPU::ROL<nes_addr_mode_abs>,            nes_addr_mode_abs,       6);
+    op(0x3E, &NES_CPU::ROL<nes_addr_mode_abs_x>,          nes_addr_mode_abs_x,     7);
+    // ROR
+    op(0x6A, &NES_CPU::ROR<nes_addr_mode_acc>,            nes_addr_mode_acc,       2);
+    op(0x66, &NES_CPU::ROR<nes_addr_mode_zp>,             nes_addr_mode_zp,        5);
+    op(0x76, &NES_CPU::ROR<nes_addr_mode_zp_x>,           nes_addr_mode_zp_x,      6);
+    op(0x6E, &NES_CPU::ROR<nes_addr_mode_abs>,            nes_addr_mode_abs,       6);
+    op(0x7E, &NES_CPU::ROR<nes_addr_mode_abs_x>,          nes_addr_mode_abs_x,     7);
+    // RTI, RTS
+    op(0x40, &NES_CPU::RTI,                               nes_addr_mode_imp,       6);
+    op(0x60, &NES_CPU::RTS,                               nes_addr_mode_imp,       6);
+    // SBC
+    op(0xE9, &NES_CPU::SBC<nes_addr_mode_imm>,            nes_addr_mode_imm,       2);
+    op(0xE5, &NES_CPU::SBC<nes_addr_mode_zp>,             nes_addr_mode_zp,        3);
+    op(0xF5, &NES_CPU::SBC<nes_addr_mode_zp_x>,           nes_addr_mode_zp_x,      4);
+    op(0xED, &NES_CPU::SBC<nes_addr_mode_abs>,            nes_addr_mode_abs,       4);
+    op(0xFD, &NES_CPU::SBC<nes_addr_mode_abs_x>,          nes_addr_mode_abs_x,     4, 1);
+    op(0xF9, &NES_CPU::SBC<nes_addr_mode_abs_y>,          nes_addr_mode_abs_y,     4, 1);
+    op(0xE1, &NES_CPU::SBC<nes_addr_mode_zp_ind_x>,       nes_addr_mode_zp_ind_x,  6);
+    op(0xF1, &NES_CPU::SBC<nes_addr_mode_zp_ind_y>,       nes_addr_mode_zp_ind_y,  5, 1);
+    // STA
+    op(0x85, &NES_CPU::STA<nes_addr_mode_zp>,             nes_addr_mode_zp,        3);
+    op(0x95, &NES_CPU::STA<nes_addr_mode_zp_x>,           nes_addr_mode_zp_x,      4);
+    op(0x8D, &NES_CPU::STA<nes_addr_mode_abs>,            nes_addr_mode_abs,       4);
+    op(0x9D, &NES_CPU::STA<nes_addr_mode_abs_x>,          nes_addr_mode_abs_x,     5);
+    op(0x99, &NES_CPU::STA<nes_addr_mode_abs_y>,          nes_addr_mode_abs_y,     5);
+    op(0x81, &NES_CPU::STA<nes_addr_mode_zp_ind_x>,       nes_addr_mode_zp_ind_x,  6);
+    op(0x91, &NES_CPU::STA<nes_addr_mode_zp_ind_y>,       nes_addr_mode_zp_ind_y,  6);
+    // STX
+    op(0x86, &NES_CPU::STX<nes_addr_mode_zp>,             nes_addr_mode_zp,        3);
+    op(0x96, &NES_CPU::STX<nes_addr_mode_zp_y>,           nes_addr_mode_zp_y,      4);
+    op(0x8E, &NES_CPU::STX<nes_addr_mode_abs>,            nes_addr_mode_abs,       4);
+    // STY
+    op(0x84, &NES_CPU::STY<nes_addr_mode_zp>,             nes_addr_mode_zp,        3);
+    op(0x94, &NES_CPU::STY<nes_addr_mode_zp_x>,           nes_addr_mode_zp_x,      4);
+    op(0x8C, &NES_CPU::STY<nes_addr_mode_abs>,            nes_addr_mode_abs,       4);
+    // Transfers
+    op(0xAA, &NES_CPU::TAX,                               nes_addr_mode_imp,       2);
+    op(0xA8, &NES_CPU::TAY,                               nes_addr_mode_imp,       2);
+    op(0xBA, &NES_CPU::TSX,                               nes_addr_mode_imp,       2);
+    op(0x8A, &NES_CPU::TXA,                               nes_addr_mode_imp,       2);
+    op(0x9A, &NES_CPU::TXS,                               nes_addr_mode_imp,       2);
+    op(0x98, &NES_CPU::TYA,                               nes_addr_mode_imp,       2);
+
+    return table;
+  }
+
+  constexpr std::array<NES_CPU::opcode_info, 256> NES_CPU::OPCODE_TABLE = NES_CPU::build_opcode_table();
+
+  NES_CPU::NES_CPU(NES_Bus* bus, nes_cpu_core core) {
+    this->bus = bus;
+    this->core = core;
+    block_cache = core == nes_cpu_core_block || core == nes_cpu_core_jit ? new NES_CPU_Block_Cache() : nullptr;
+    jit = nullptr;
+
+    m_result = 0;
+    m_lazy_nz = false;
+    batch_cycles = 0;
+    batch_budget = 0;
+
+    // Without executable memory the JIT core runs as the block core.
+    if (core == nes_cpu_core_jit && NES_CPU_JIT::is_supported()) {
+      jit = new NES_CPU_JIT(this);
+
+      if (!jit->has_code_memory()) {
+        delete jit;
+        jit = nullptr;
+      }
+    }
+  }
+
+  NES_CPU::~NES_CPU() {
+    delete jit;
+    delete block_cache;
+  }
+
   // Helpers
   cycle_t NES_CPU::reset() {
     A() = 0;
@@ -23,8 +266,8 @@ namespace NES_Emulator {
   }
 
   cycle_t NES_CPU::IRQ() {
-    if (P() & I)
-      return;
+    if (get_flag(I))
+      return 0;
     
     bus->cpu_write(0x0100 + SP()--, (PC() >> 8) & 0x00FF);
     bus->cpu_write(0x0100 + SP()--, PC() & 0x00FF);
@@ -34,10 +277,10 @@ namespace NES_Emulator {
 		set_flag(I, 1);
     bus->cpu_write(0x0100 + SP()--, P());
 
-    addr_abs = 0xFFEE;
+    addr_abs = 0xFFFE;
     BYTE lo = bus->cpu_read(addr_abs + 0);
 		BYTE hi = bus->cpu_read(addr_abs + 1);
-    PC() = (hi << 8) & lo;
+    PC() = (hi << 8) | lo;
 
     return 7;
   }
@@ -51,42 +294,297 @@ namespace NES_Emulator {
 		set_flag(I, 1);
     bus->cpu_write(0x0100 + SP()--, P());
 
-    addr_abs = 0xFFEE;
+    addr_abs = 0xFFFA;
     BYTE lo = bus->cpu_read(addr_abs + 0);
 		BYTE hi = bus->cpu_read(addr_abs + 1);
-    PC() = (hi << 8) & lo;
+    PC() = (hi << 8) | lo;
 
     return 8;
   }
 
   void NES_CPU::set_flag(BYTE F, bool v) {
-    if (v)
-      P() |= F;
-    else
-      P() &= ~F;
+    if (F & (N | Z))
+      materialize_flags();
+
+    m_status = (m_status & ~F) | (v ? F : 0);
+  }
+
+  bool NES_CPU::get_flag(BYTE F) {
+    if (m_lazy_nz && F == N)
+      return m_result & N;
+    if (m_lazy_nz && F == Z)
+      return m_result == 0;
+
+    return m_status & F;
   }
 
   void NES_CPU::calc_alu_flags(BYTE val) {
-    // N
-    set_flag(N, val & N);
+    // N and Z are worked out from the result when something reads them.
+    m_result = val;
+    m_lazy_nz = true;
+  }
 
-    // Z
-    set_flag(Z, val == 0);
+  void NES_CPU::materialize_flags() {
+    if (!m_lazy_nz)
+      return;
+
+    m_status = (m_status & ~(N | Z)) | (m_result & N) | (m_result == 0 ? Z : 0);
+    m_lazy_nz = false;
+  }
+
+  cycle_t NES_CPU::run_instruction(opcode_t op) {
+    const opcode_info &info = OPCODE_TABLE[op];
+    fetch_operand(info.length);
+    return info.cycles + (this->*info.handler)();
   }
 
-  cycle_t NES_CPU::get_cpu_cycles(opcode_t op) {
-    // Check for NOP
-    if (!BASE_OPERATION_CYCLES.count(op))
+  void NES_CPU::fetch_operand(BYTE length) {
+    operand = 0;
+
+    if (length > 1)
+      operand = bus->cpu_read(PC()++);
+    if (length > 2)
+      operand |= bus->cpu_read(PC()++) << 8;
+  }
+
+  unsigned int NES_CPU::run(unsigned int budget) {
+    unsigned int elapsed;
+    batch_budget = budget;
+
+    if (core == nes_cpu_core_threaded)
+      elapsed = run_threaded();
+    else if (core == nes_cpu_core_block)
+      elapsed = run_block();
+    else if (core == nes_cpu_core_jit)
+      elapsed = jit ? run_jit() : run_block();
+    else
+      elapsed = run_table();
+
+    // Outside of run() there is no batch in progress.
+    batch_cycles = 0;
+
+    return elapsed;
+  }
+
+  unsigned int NES_CPU::get_batch_cycles() {
+    return batch_cycles;
+  }
+
+  void NES_CPU::serialize(NES_State &state) {
+    // P is stored whole, the lazy flags are folded in first.
+    materialize_flags();
+
+    state.value(m_accumulator);
+    state.value(m_x);
+    state.value(m_y);
+    state.value(m_stackPointer);
+    state.value(m_status);
+    state.value(m_programCounter);
+  }
+
+  void NES_CPU::stall(unsigned int cycles) {
+    batch_cycles += cycles;
+  }
+
+  void NES_CPU::end_batch() {
+    // The instruction in flight has not been counted yet, so it still completes.
+    batch_budget = std::min(batch_budget, batch_cycles);
+  }
+
+  unsigned int NES_CPU::run_table() {
+    const unsigned int &budget = batch_budget;
+    unsigned int &elapsed = batch_cycles;
+    elapsed = 0;
+
+    while (elapsed < budget)
+      elapsed += run_instruction(bus->cpu_read(PC()++));
+
+    return elapsed;
+  }
+
+  unsigned int NES_CPU::run_threaded() {
+#if defined(__GNUC__)
+    /**
+     * Every opcode gets its own label that runs the handler and jumps straight
+     * to the next opcode's label, so each instruction has its own indirect
+     * branch for the predictor to learn instead of one shared dispatch site.
+     */
+    #define NES_CPU_THREADED_ROW(M, hi) \
+      M(hi, 0) M(hi, 1) M(hi, 2) M(hi, 3) M(hi, 4) M(hi, 5) M(hi, 6) M(hi, 7) \
+      M(hi, 8) M(hi, 9) M(hi, A) M(hi, B) M(hi, C) M(hi, D) M(hi, E) M(hi, F)
+    #define NES_CPU_THREADED_ALL(M) \
+      NES_CPU_THREADED_ROW(M, 0) NES_CPU_THREADED_ROW(M, 1) NES_CPU_THREADED_ROW(M, 2) NES_CPU_THREADED_ROW(M, 3) \
+      NES_CPU_THREADED_ROW(M, 4) NES_CPU_THREADED_ROW(M, 5) NES_CPU_THREADED_ROW(M, 6) NES_CPU_THREADED_ROW(M, 7) \
+      NES_CPU_THREADED_ROW(M, 8) NES_CPU_THREADED_ROW(M, 9) NES_CPU_THREADED_ROW(M, A) NES_CPU_THREADED_ROW(M, B) \
+      NES_CPU_THREADED_ROW(M, C) NES_CPU_THREADED_ROW(M, D) NES_CPU_THREADED_ROW(M, E) NES_CPU_THREADED_ROW(M, F)
+    #define NES_CPU_THREADED_LABEL(hi, lo) &&op_##hi##lo,
+    #define NES_CPU_THREADED_OP(hi, lo) \
+      op_##hi##lo: \
+        fetch_operand(OPCODE_TABLE[0x##hi##lo].length); \
+        elapsed += OPCODE_TABLE[0x##hi##lo].cycles + (this->*OPCODE_TABLE[0x##hi##lo].handler)(); \
+        if (elapsed >= budget) \
+          return elapsed; \
+        goto *DISPATCH[bus->cpu_read(PC()++)];
+
+    static void* const DISPATCH[256] = { NES_CPU_THREADED_ALL(NES_CPU_THREADED_LABEL) };
+    const unsigned int &budget = batch_budget;
+    unsigned int &elapsed = batch_cycles;
+    elapsed = 0;
+
+    if (budget == 0)
       return 0;
-    
-    return BASE_OPERATION_CYCLES.at(op);
+
+    goto *DISPATCH[bus->cpu_read(PC()++)];
+    NES_CPU_THREADED_ALL(NES_CPU_THREADED_OP)
+
+    #undef NES_CPU_THREADED_OP
+    #undef NES_CPU_THREADED_LABEL
+    #undef NES_CPU_THREADED_ALL
+    #undef NES_CPU_THREADED_ROW
+#else
+    return run_table();
+#endif
   }
 
-  cycle_t NES_CPU::run_instruction(opcode_t op) {
-    if (!OPERATION_INSTRUCTIONS.count(op))
-      return NOP(op);
-    
-    return (this->*OPERATION_INSTRUCTIONS.at(op))(op);
+  unsigned int NES_CPU::run_block() {
+    const unsigned int &bank_generation = bus->get_bank_generation();
+    const unsigned int &budget = batch_budget;
+    unsigned int &elapsed = batch_cycles;
+    elapsed = 0;
+
+    while (elapsed < budget) {
+      NES_CPU_Block_Cache::block* block = fetch_block();
+
+      if (!block) {
+        elapsed += run_instruction(bus->cpu_read(PC()++));
+        continue;
+      }
+
+      execute_block(*block, bank_generation);
+    }
+
+    return elapsed;
+  }
+
+  unsigned int NES_CPU::run_jit() {
+    const unsigned int &bank_generation = bus->get_bank_generation();
+    const unsigned int &budget = batch_budget;
+    unsigned int &elapsed = batch_cycles;
+    elapsed = 0;
+
+    while (elapsed < budget) {
+      NES_CPU_Block_Cache::block* block = fetch_block();
+
+      if (!block) {
+        elapsed += run_instruction(bus->cpu_read(PC()++));
+        continue;
+      }
+
+      if (!block->native && ++block->executions >= NES_CPU_JIT::HOT_BLOCK_EXECUTIONS) {
+        block->native = (void*)jit->compile(*block);
+
+        // Out of executable memory, start again from empty caches.
+        if (!block->native) {
+          jit->clear();
+          block_cache->clear();
+          continue;
+        }
+      }
+
+      if (block->native)
+        elapsed = jit->run(*block, elapsed, budget, bank_generation);
+      else
+        execute_block(*block, bank_generation);
+    }
+
+    return elapsed;
+  }
+
+  NES_CPU_Block_Cache::block* NES_CPU::fetch_block() {
+    // RAM and PRG RAM can be rewritten at any time, so only PRG ROM is decoded ahead.
+    if (PC() < 0x8000)
+      return nullptr;
+
+    unsigned int bank = bus->get_prg_bank(PC());
+    NES_CPU_Block_Cache::block* block = block_cache->find(PC(), bank);
+
+    if (!block) {
+      block = block_cache->allocate(PC(), bank);
+      decode_block(PC(), bank, *block);
+    }
+
+    // Instructions straddling a bank edge are never decoded.
+    if (block->length == 0)
+      return nullptr;
+
+    return block;
+  }
+
+  void NES_CPU::execute_block(const NES_CPU_Block_Cache::block &block, const unsigned int &bank_generation) {
+    const unsigned int &budget = batch_budget;
+    unsigned int &elapsed = batch_cycles;
+    unsigned int generation = bank_generation;
+
+    for (BYTE i = 0; i < block.length; i++) {
+      const NES_CPU_Block_Cache::micro_op &micro_op = block.ops[i];
+      operand = micro_op.operand;
+      PC() = micro_op.next_pc;
+      elapsed += micro_op.cycles + (this->*micro_op.handler)();
+
+      // Stop at the budget like the other cores, or when a mapper write
+      // switched banks under the rest of the block.
+      if (elapsed >= budget || bank_generation != generation)
+        break;
+    }
+
+  }
+
+  void NES_CPU::decode_block(address_t pc, unsigned int bank, NES_CPU_Block_Cache::block &block) {
+    block.length = 0;
+    block.bank = bank;
+    block.cycles = 0;
+    block.executions = 0;
+    block.native = nullptr;
+    address_t block_pc = pc;
+
+    while (block.length < NES_CPU_Block_Cache::MAX_BLOCK_OPS) {
+      const opcode_info &info = OPCODE_TABLE[bus->cpu_read(pc)];
+      address_t last = pc + info.length - 1;
+
+      // Leave instructions that run off the end of the 8KB bank window (or
+      // memory) to the interpreter, the next window is switched on its own.
+      if (last < pc || (last & 0xE000) != (block_pc & 0xE000))
+        break;
+
+      NES_CPU_Block_Cache::micro_op &micro_op = block.ops[block.length++];
+      micro_op.handler = info.handler;
+      micro_op.opcode = bus->cpu_read(pc);
+      micro_op.operand = 0;
+      micro_op.next_pc = last + 1;
+      micro_op.cycles = info.cycles;
+
+      if (info.length > 1)
+        micro_op.operand = bus->cpu_read(pc + 1);
+      if (info.length > 2)
+        micro_op.operand |= bus->cpu_read(pc + 2) << 8;
+
+      block.cycles += info.cycles;
+
+      if (ends_block(info) || micro_op.next_pc < pc)
+        break;
+
+      pc = micro_op.next_pc;
+    }
+  }
+
+  bool NES_CPU::ends_block(const opcode_info &info) {
+    return info.addr_mode == nes_addr_mode_rel ||
+      info.handler == &NES_CPU::JMP<nes_addr_mode_abs> ||
+      info.handler == &NES_CPU::JMP<nes_addr_mode_ind_jmp> ||
+      info.handler == &NES_CPU::JSR ||
+      info.handler == &NES_CPU::RTS ||
+      info.handler == &NES_CPU::RTI ||
+      info.handler == &NES_CPU::BRK;
   }
 
   cycle_t NES_CPU::branch() {
@@ -108,70 +606,41 @@ namespace NES_Emulator {
     return address >> 8;
   }
 
-  nes_addr_mode NES_CPU::get_address_mode(opcode_t op) {
-    if (!OPERATION_ADDRESS_MODES.count(op))
-      return nes_addr_mode::nes_addr_mode_imp;
-    
-    return OPERATION_ADDRESS_MODES.at(op);
-  }
-
-  cycle_t NES_CPU::set_value_for_address_mode(nes_addr_mode addr_mode) {
-    if (!ADDRESS_MODE_FUNCTIONS.count(addr_mode))
-      return IMP();
-    
-    return (this->*ADDRESS_MODE_FUNCTIONS.at(addr_mode))();
-  }
-
-  BYTE NES_CPU::get_value_for_address_mode(nes_addr_mode addr_mode) {
-    if (MEMORY_ADDRESSING_MODES.count(addr_mode)) {
-      return bus->cpu_read(addr_abs);
-    } else if (addr_mode == nes_addr_mode::nes_addr_mode_acc) {
-      return A();
-    }
-
-    return imm;
-  }
-
   cycle_t NES_CPU::IMP() {
     return 0;
   }
 
   cycle_t NES_CPU::IMM() {
-    imm = bus->cpu_read(PC()++);
+    imm = operand & 0x00FF;
     return 0;
   }
 
   cycle_t NES_CPU::ZP0() {
-    addr_abs = bus->cpu_read(PC()++);
-    addr_abs &= 0x00FF;
+    addr_abs = operand & 0x00FF;
     return 0;
   }
 
   cycle_t NES_CPU::ZPX() {
-    addr_abs = (address_t)bus->cpu_read(PC()++) + X();
+    addr_abs = operand + X();
     addr_abs &= 0x00FF;
     return 0;
   }
 
   cycle_t NES_CPU::ZPY() {
-    addr_abs = (address_t)bus->cpu_read(PC()++) + Y();
+    addr_abs = operand + Y();
     addr_abs &= 0x00FF;
     return 0;
   }
 
   cycle_t NES_CPU::ABS() {
-    BYTE lo = bus->cpu_read(PC()++);
-    BYTE hi = bus->cpu_read(PC()++);
-
-    addr_abs = (hi << 8) | lo;
+    addr_abs = operand;
     return 0;
   }
 
   cycle_t NES_CPU::ABX() {
-    BYTE lo = bus->cpu_read(PC()++);
-    BYTE hi = bus->cpu_read(PC()++);
+    BYTE hi = operand >> 8;
 
-    addr_abs = (hi << 8) | lo;
+    addr_abs = operand;
     addr_abs += X();
 
     if (get_page(addr_abs) != hi) {
@@ -182,10 +651,9 @@ namespace NES_Emulator {
   }
 
   cycle_t NES_CPU::ABY() {
-    BYTE lo = bus->cpu_read(PC()++);
-    BYTE hi = bus->cpu_read(PC()++);
+    BYTE hi = operand >> 8;
 
-    addr_abs = (hi << 8) | lo;
+    addr_abs = operand;
     addr_abs += Y();
 
     if (get_page(addr_abs) != hi) {
@@ -196,10 +664,8 @@ namespace NES_Emulator {
   }
 
   cycle_t NES_CPU::IND() {
-    BYTE lo = bus->cpu_read(PC()++);
-    BYTE hi = bus->cpu_read(PC()++);
-
-    address_t ptr = (hi << 8) | lo;
+    BYTE lo = operand & 0x00FF;
+    address_t ptr = operand;
 
     if (lo == 0x00FF) {
       addr_abs = (bus->cpu_read(ptr & 0xFF00) << 8) | bus->cpu_read(ptr);
@@ -211,7 +677,7 @@ namespace NES_Emulator {
   }
 
   cycle_t NES_CPU::IZX() {
-    address_t ptr = (address_t)bus->cpu_read(PC()++) + X();
+    address_t ptr = operand + X();
     ptr &= 0x00FF;
 
     addr_abs = (bus->cpu_read((ptr + 1) & 0x00FF) << 8) | bus->cpu_read(ptr);
@@ -219,8 +685,7 @@ namespace NES_Emulator {
   }
 
   cycle_t NES_CPU::IZY() {
-    address_t ptr = bus->cpu_read(PC()++);
-    ptr &= 0x00FF;
+    address_t ptr = operand & 0x00FF;
 
     addr_abs = (bus->cpu_read((ptr + 1) & 0x00FF) << 8) | bus->cpu_read(ptr);
     addr_abs += Y();
@@ -233,7 +698,7 @@ namespace NES_Emulator {
   }
 
   cycle_t NES_CPU::REL() {
-    addr_rel = bus->cpu_read(PC()++);
+    addr_rel = operand & 0x00FF;
     if (addr_rel & 0x80) {
       addr_rel |= 0xFF00;
     }
@@ -241,15 +706,76 @@ namespace NES_Emulator {
     return 0;
   }
 
+  // Address Mode Helpers
+  template<nes_addr_mode M>
+  cycle_t NES_CPU::address() {
+    if constexpr (M == nes_addr_mode_imm)
+      return IMM();
+    else if constexpr (M == nes_addr_mode_zp)
+      return ZP0();
+    else if constexpr (M == nes_addr_mode_zp_x)
+      return ZPX();
+    else if constexpr (M == nes_addr_mode_zp_y)
+      return ZPY();
+    else if constexpr (M == nes_addr_mode_abs || M == nes_addr_mode_abs_jmp)
+      return ABS();
+    else if constexpr (M == nes_addr_mode_abs_x)
+      return ABX();
+    else if constexpr (M == nes_addr_mode_abs_y)
+      return ABY();
+    else if constexpr (M == nes_addr_mode_ind_jmp)
+      return IND();
+    else if constexpr (M == nes_addr_mode_zp_ind_x)
+      return IZX();
+    else if constexpr (M == nes_addr_mode_zp_ind_y)
+      return IZY();
+    else if constexpr (M == nes_addr_mode_rel)
+      return REL();
+    else
+      return IMP();
+  }
+
+  template<nes_addr_mode M>
+  BYTE NES_CPU::read_operand() {
+    if constexpr (M == nes_addr_mode_acc)
+      return A();
+    else if constexpr (M == nes_addr_mode_imm)
+      return imm;
+    else
+      return bus->cpu_read(addr_abs);
+  }
+
+  template<nes_addr_mode M>
+  void NES_CPU::write_operand(BYTE val) {
+    if constexpr (M == nes_addr_mode_acc)
+      A() = val;
+    else
+      bus->cpu_write(addr_abs, val);
+  }
+
+  void NES_CPU::compare(BYTE reg, BYTE val) {
+    WORD cmp;
+
+    val = val ^ 0x00FF;
+    cmp = (int)reg + val;
+
+    set_flag(C, cmp > 0x00FF);
+    set_flag(V, 
+      (reg < 0x80 && val < 0x80 && cmp >= 0x80) || 
+      (reg > 0x80 && val > 0x80 && cmp < 0x80)
+    );
+
+    calc_alu_flags(cmp);
+  }
+
   // Instructions
-  cycle_t NES_CPU::ADC(opcode_t op) {
+  template<nes_addr_mode M>
+  cycle_t NES_CPU::ADC() {
     /**
      * Add with carry.
      */
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = get_address_mode(op);
-    cycles += set_value_for_address_mode(addr_mode);
-    BYTE val = get_value_for_address_mode(addr_mode);
+    cycle_t page_crossed = address<M>();
+    BYTE val = read_operand<M>();
 
     set_flag(C, (int)A() + val > 0x00FF);
     set_flag(V, 
@@ -262,518 +788,389 @@ namespace NES_Emulator {
     // Calculate flags
     calc_alu_flags(A());
 
-    // Cycle count
-    return get_cpu_cycles(op);
+    return page_crossed;
   }
 
-  cycle_t NES_CPU::AND(opcode_t op) {
+  template<nes_addr_mode M>
+  cycle_t NES_CPU::AND() {
     /**
      * And (with accumulator).
      */
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = get_address_mode(op);
-    cycles += set_value_for_address_mode(addr_mode);
-    BYTE val = get_value_for_address_mode(addr_mode);
+    cycle_t page_crossed = address<M>();
 
-    A() &= val;
+    A() &= read_operand<M>();
 
     // Calculate flags
     calc_alu_flags(A());
 
-    // Cycle count
-    return cycles;
+    return page_crossed;
   }
 
-  cycle_t NES_CPU::ASL(opcode_t op) {
+  template<nes_addr_mode M>
+  cycle_t NES_CPU::ASL() {
     /**
      * Arithmetic shift left.
      */
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = get_address_mode(op);
-    cycles += set_value_for_address_mode(addr_mode);
+    address<M>();
+    BYTE data = read_operand<M>();
 
-    if (addr_mode == nes_addr_mode::nes_addr_mode_acc) {
-      set_flag(C, A() & 0x80);
-      A() <<= 1;
-      calc_alu_flags(A());
-    } else {
-      BYTE data = bus->cpu_read(addr_abs);
-      set_flag(C, data & 0x80);
-      data <<= 1;
-      calc_alu_flags(data);
-      bus->cpu_write(addr_abs, data);
-    }
+    set_flag(C, data & 0x80);
+    data <<= 1;
+    calc_alu_flags(data);
+    write_operand<M>(data);
 
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::BCC(opcode_t op) {
+  cycle_t NES_CPU::BCC() {
     /**
      * Branch on carry clear.
      */
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = nes_addr_mode::nes_addr_mode_rel;
-    cycles += set_value_for_address_mode(addr_mode);
-
-    if (~P() & C) {
-      cycles += branch();
-    }
-
-    return cycles;
+    REL();
+    return !get_flag(C) ? branch() : 0;
   }
 
-  cycle_t NES_CPU::BCS(opcode_t op) {
+  cycle_t NES_CPU::BCS() {
     /**
      * Branch on carry set.
      */
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = nes_addr_mode::nes_addr_mode_rel;
-    cycles += set_value_for_address_mode(addr_mode);
-
-    if (P() & C) {
-      cycles += branch();
-    }
-
-    return cycles;
+    REL();
+    return get_flag(C) ? branch() : 0;
   }
 
-  cycle_t NES_CPU::BEQ(opcode_t op) {
+  cycle_t NES_CPU::BEQ() {
     /**
      * Branch on equal (zero set).
      */
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = nes_addr_mode::nes_addr_mode_rel;
-    cycles += set_value_for_address_mode(addr_mode);
-
-    if (P() & Z) {
-      cycles += branch();
-    }
-
-    return cycles;
+    REL();
+    return get_flag(Z) ? branch() : 0;
   }
 
-  cycle_t NES_CPU::BIT(opcode_t op) {
+  template<nes_addr_mode M>
+  cycle_t NES_CPU::BIT() {
     /**
      * Bit test.
      */
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = get_address_mode(op);
-    cycles += set_value_for_address_mode(addr_mode);
-    BYTE val = get_value_for_address_mode(addr_mode);
+    address<M>();
+    BYTE val = read_operand<M>();
 
     calc_alu_flags(A() & val);
     set_flag(N, val & 0b10000000);
     set_flag(V, val & 0b01000000);
 
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::BMI(opcode_t op) {
+  cycle_t NES_CPU::BMI() {
     /**
      * Branch on minus (negative set).
      */
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = nes_addr_mode::nes_addr_mode_rel;
-    cycles += set_value_for_address_mode(addr_mode);
-
-    if (P() & N) {
-      cycles += branch();
-    }
-
-    return cycles;
+    REL();
+    return get_flag(N) ? branch() : 0;
   }
 
-  cycle_t NES_CPU::BNE(opcode_t op) {
+  cycle_t NES_CPU::BNE() {
     /**
      * Branch on not equal (zero clear).
      */
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = nes_addr_mode::nes_addr_mode_rel;
-    cycles += set_value_for_address_mode(addr_mode);
-
-    if (~P() & Z) {
-      cycles += branch();
-    }
-
-    return cycles;
+    REL();
+    return !get_flag(Z) ? branch() : 0;
   }
 
-  cycle_t NES_CPU::BPL(opcode_t op) {
+  cycle_t NES_CPU::BPL() {
     /**
      * Branch on plus (negative clear).
      */
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = nes_addr_mode::nes_addr_mode_rel;
-    cycles += set_value_for_address_mode(addr_mode);
-
-    if (~P() & N) {
-      cycles += branch();
-    }
-
-    return cycles;
+    REL();
+    return !get_flag(N) ? branch() : 0;
   }
 
-  cycle_t NES_CPU::BRK(opcode_t op) {
+  cycle_t NES_CPU::BRK() {
     /**
      * Break / interrupt.
      */
-    operand_t val = 0;
-
-    
-
-    // Cycle count
-    return get_cpu_cycles(op);
+    return 0;
   }
 
-  cycle_t NES_CPU::BVC(opcode_t op) {
+  cycle_t NES_CPU::BVC() {
     /**
      * Branch on overflow clear.
      */
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = nes_addr_mode::nes_addr_mode_rel;
-    cycles += set_value_for_address_mode(addr_mode);
-
-    if (~P() & V) {
-      cycles += branch();
-    }
-
-    return cycles;
+    REL();
+    return !get_flag(V) ? branch() : 0;
   }
 
-  cycle_t NES_CPU::BVS(opcode_t op) {
+  cycle_t NES_CPU::BVS() {
     /**
      * Branch on overflow set.
      */
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = nes_addr_mode::nes_addr_mode_rel;
-    cycles += set_value_for_address_mode(addr_mode);
-
-    if (P() & V) {
-      cycles += branch();
-    }
-
-    return cycles;
+    REL();
+    return get_flag(V) ? branch() : 0;
   }
 
-  cycle_t NES_CPU::CLC(opcode_t op) {
+  cycle_t NES_CPU::CLC() {
     /**
      * Clear Carry Flag.
      */
-    // Cycle count
-    cycle_t cycles = get_cpu_cycles(op);
     set_flag(C, 0);
-
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::CLD(opcode_t op) {
+  cycle_t NES_CPU::CLD() {
     /**
      * Clear Decimal Flag.
      */
-    // Cycle count
-    cycle_t cycles = get_cpu_cycles(op);
     set_flag(D, 0);
-
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::CLI(opcode_t op) {
+  cycle_t NES_CPU::CLI() {
     /**
      * Clear Interrupt disable bit.
      */
-    // Cycle count
-    cycle_t cycles = get_cpu_cycles(op);
     set_flag(I, 0);
-
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::CLV(opcode_t op) {
+  cycle_t NES_CPU::CLV() {
     /**
      * Clear Overflow flag.
      */
-    // Cycle count
-    cycle_t cycles = get_cpu_cycles(op);
     set_flag(V, 0);
-
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::CMP(opcode_t op) {
+  template<nes_addr_mode M>
+  cycle_t NES_CPU::CMP() {
     /**
      * Compare Memory with Accumulator.
      */
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = get_address_mode(op);
-    cycles += set_value_for_address_mode(addr_mode);
-    BYTE val = get_value_for_address_mode(addr_mode);
-    WORD cmp;
-
-    val = val ^ 0x00FF;
-    cmp = (int)A() + val;
-
-    set_flag(C, cmp > 0x00FF);
-    set_flag(V, 
-      (A() < 0x80 && val < 0x80 && cmp >= 0x80) || 
-      (A() > 0x80 && val > 0x80 && cmp < 0x80)
-    );
-
-    calc_alu_flags(cmp);
+    cycle_t page_crossed = address<M>();
+    compare(A(), read_operand<M>());
 
-    return cycles;
+    return page_crossed;
   }
 
-  cycle_t NES_CPU::CPX(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = get_address_mode(op);
-    cycles += set_value_for_address_mode(addr_mode);
-    BYTE val = get_value_for_address_mode(addr_mode);
-    WORD cmp;
-
-    val = val ^ 0x00FF;
-    cmp = (int)X() + val;
-
-    set_flag(C, cmp > 0x00FF);
-    set_flag(V, 
-      (X() < 0x80 && val < 0x80 && cmp >= 0x80) || 
-      (X() > 0x80 && val > 0x80 && cmp < 0x80)
-    );
-
-    calc_alu_flags(cmp);
+  template<nes_addr_mode M>
+  cycle_t NES_CPU::CPX() {
+    /**
+     * Compare Memory with X.
+     */
+    address<M>();
+    compare(X(), read_operand<M>());
 
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::CPY(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = get_address_mode(op);
-    cycles += set_value_for_address_mode(addr_mode);
-    BYTE val = get_value_for_address_mode(addr_mode);
-    WORD cmp;
-
-    val = val ^ 0x00FF;
-    cmp = (int)Y() + val;
-
-    set_flag(C, cmp > 0x00FF);
-    set_flag(V, 
-      (Y() < 0x80 && val < 0x80 && cmp >= 0x80) || 
-      (Y() > 0x80 && val > 0x80 && cmp < 0x80)
-    );
-
-    calc_alu_flags(cmp);
+  template<nes_addr_mode M>
+  cycle_t NES_CPU::CPY() {
+    /**
+     * Compare Memory with Y.
+     */
+    address<M>();
+    compare(Y(), read_operand<M>());
 
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::DEC(opcode_t op) {
+  template<nes_addr_mode M>
+  cycle_t NES_CPU::DEC() {
     /**
      * Decrement Memory by one.
      */
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = get_address_mode(op);
-    cycles += set_value_for_address_mode(addr_mode);
-    BYTE val = bus->cpu_read(addr_abs);
+    address<M>();
+    BYTE val = read_operand<M>();
 
     val -= 1;
 
     calc_alu_flags(val);
-    bus->cpu_write(addr_abs, val);
+    write_operand<M>(val);
 
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::DEX(opcode_t op) {
+  cycle_t NES_CPU::DEX() {
     /**
      * Decrement X by one.
      */
-    // Cycle count
-    cycle_t cycles = get_cpu_cycles(op);
     X() -= 1;
 
     calc_alu_flags(X());
 
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::DEY(opcode_t op) {
+  cycle_t NES_CPU::DEY() {
     /**
      * Decrement Y by one.
      */
-    // Cycle count
-    cycle_t cycles = get_cpu_cycles(op);
     Y() -= 1;
     
     calc_alu_flags(Y());
 
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::EOR(opcode_t op) {
+  template<nes_addr_mode M>
+  cycle_t NES_CPU::EOR() {
     /**
      * Exclusive-OR with memory and accumulator.
      */
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = get_address_mode(op);
-    cycles += set_value_for_address_mode(addr_mode);
-    BYTE val = get_value_for_address_mode(addr_mode);
+    cycle_t page_crossed = address<M>();
 
-    A() ^= val;
+    A() ^= read_operand<M>();
 
     calc_alu_flags(A());
     
-    return cycles;
+    return page_crossed;
   }
 
-  cycle_t NES_CPU::INC(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = get_address_mode(op);
-    cycles += set_value_for_address_mode(addr_mode);
-    BYTE val = bus->cpu_read(addr_abs);
+  template<nes_addr_mode M>
+  cycle_t NES_CPU::INC() {
+    /**
+     * Increment Memory by one.
+     */
+    address<M>();
+    BYTE val = read_operand<M>();
 
     val = (int)val + 1;
 
     calc_alu_flags(val);
-    bus->cpu_write(addr_abs, val);
+    write_operand<M>(val);
 
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::INX(opcode_t op) {
+  cycle_t NES_CPU::INX() {
     /**
      * Increment X by one.
      */
-    cycle_t cycles = get_cpu_cycles(op);
     X() = (int)X() + 1;
 
     calc_alu_flags(X());
 
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::INY(opcode_t op) {
+  cycle_t NES_CPU::INY() {
     /**
      * Increment Y by one.
      */
-    cycle_t cycles = get_cpu_cycles(op);
     Y() = (int)Y() + 1;
 
     calc_alu_flags(Y());
 
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::JMP(opcode_t op) {
+  template<nes_addr_mode M>
+  cycle_t NES_CPU::JMP() {
     /**
      * Jump to new location.
      */
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = get_address_mode(op);
-    cycles += set_value_for_address_mode(addr_mode);
-
+    address<M>();
     jump();
 
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::JSR(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = nes_addr_mode::nes_addr_mode_abs_jmp;
-    cycles += set_value_for_address_mode(addr_mode);
+  cycle_t NES_CPU::JSR() {
+    /**
+     * Jump to subroutine.
+     */
+    ABS();
 
     bus->cpu_write(SP()++, PC() + 2);
     bus->cpu_write(SP()++, (PC() + 2) >> 8);
 
     jump();
 
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::LDA(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = get_address_mode(op);
-    cycles += set_value_for_address_mode(addr_mode);
-    BYTE val = get_value_for_address_mode(addr_mode);
+  template<nes_addr_mode M>
+  cycle_t NES_CPU::LDA() {
+    /**
+     * Load Accumulator with memory.
+     */
+    cycle_t page_crossed = address<M>();
 
-    A() = val;
+    A() = read_operand<M>();
 
     calc_alu_flags(A());
 
-    return cycles;
+    return page_crossed;
   }
 
-  cycle_t NES_CPU::LDX(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = get_address_mode(op);
-    cycles += set_value_for_address_mode(addr_mode);
-    BYTE val = get_value_for_address_mode(addr_mode);
+  template<nes_addr_mode M>
+  cycle_t NES_CPU::LDX() {
+    /**
+     * Load X with memory.
+     */
+    cycle_t page_crossed = address<M>();
 
-    X() = val;
+    X() = read_operand<M>();
 
     calc_alu_flags(X());
     
-    return cycles;
+    return page_crossed;
   }
 
-  cycle_t NES_CPU::LDY(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = get_address_mode(op);
-    cycles += set_value_for_address_mode(addr_mode);
-    BYTE val = get_value_for_address_mode(addr_mode);
+  template<nes_addr_mode M>
+  cycle_t NES_CPU::LDY() {
+    /**
+     * Load Y with memory.
+     */
+    cycle_t page_crossed = address<M>();
 
-    Y() = val;
+    Y() = read_operand<M>();
 
     calc_alu_flags(Y());
 
-    return cycles;
+    return page_crossed;
   }
 
-  cycle_t NES_CPU::LSR(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = get_address_mode(op);
-    cycles += set_value_for_address_mode(addr_mode);
-    
-    if (addr_mode == nes_addr_mode::nes_addr_mode_acc) {
-      set_flag(C, A() & 1);
-      A() >>= 1;
-      calc_alu_flags(A());
-    } else {
-      BYTE data = bus->cpu_read(addr_abs);
-      set_flag(C, data & 1);
-      data >>= 1;
-      calc_alu_flags(data);
-      bus->cpu_write(addr_abs, data);
-    }
+  template<nes_addr_mode M>
+  cycle_t NES_CPU::LSR() {
+    /**
+     * Logical shift right.
+     */
+    address<M>();
+    BYTE data = read_operand<M>();
+
+    set_flag(C, data & 1);
+    data >>= 1;
+    calc_alu_flags(data);
+    write_operand<M>(data);
 
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::NOP(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
-    return cycles;
+  cycle_t NES_CPU::NOP() {
+    return 0;
   }
 
-  cycle_t NES_CPU::ORA(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = get_address_mode(op);
-    cycles += set_value_for_address_mode(addr_mode);
-    BYTE val = get_value_for_address_mode(addr_mode);
+  template<nes_addr_mode M>
+  cycle_t NES_CPU::ORA() {
+    /**
+     * Or memory with accumulator.
+     */
+    cycle_t page_crossed = address<M>();
 
-    A() |= val;
+    A() |= read_operand<M>();
 
     calc_alu_flags(A());
 
-    return cycles;
+    return page_crossed;
   }
 
-  cycle_t NES_CPU::PHA(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
+  cycle_t NES_CPU::PHA() {
     bus->cpu_write(0x0100 + SP()--, A());
 
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::PHP(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
+  cycle_t NES_CPU::PHP() {
     BYTE pre_push = P() & 0xFF;
 
     set_flag(B, 1);
@@ -782,71 +1179,57 @@ namespace NES_Emulator {
     bus->cpu_write(0x0100 + SP()--, P());
     P() = pre_push;
 
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::PLA(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
-
+  cycle_t NES_CPU::PLA() {
     A() = bus->cpu_read(0x0100 + ++SP());
 
     calc_alu_flags(A());
 
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::PLP(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
+  cycle_t NES_CPU::PLP() {
     P() = bus->cpu_read(0x0100 + ++SP());
 
     set_flag(_, 0);
     set_flag(B, 0);
 
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::ROL(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = get_address_mode(op);
-    cycles += set_value_for_address_mode(addr_mode);
-
-    if (addr_mode == nes_addr_mode::nes_addr_mode_acc) {
-      WORD temp = (A() << 1) | C;
+  template<nes_addr_mode M>
+  cycle_t NES_CPU::ROL() {
+    /**
+     * Rotate left.
+     */
+    address<M>();
+    WORD temp = (read_operand<M>() << 1) | C;
 
-      set_flag(C, temp > 0x00FF);
-      A() = temp & 0x00FF;
-      calc_alu_flags(A());
-    } else {
-      WORD val = bus->cpu_read(addr_abs);
+    set_flag(C, temp > 0x00FF);
+    calc_alu_flags(temp & 0x00FF);
+    write_operand<M>(temp & 0x00FF);
 
-      val = (val << 1) | C;
-      set_flag(C, val > 0x00FF);
-      calc_alu_flags(val);
-      bus->cpu_write(addr_abs, val & 0x00FF);
-    }
+    return 0;
   }
 
-  cycle_t NES_CPU::ROR(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = get_address_mode(op);
-    cycles += set_value_for_address_mode(addr_mode);
+  template<nes_addr_mode M>
+  cycle_t NES_CPU::ROR() {
+    /**
+     * Rotate right.
+     */
+    address<M>();
+    BYTE val = (C << 7) | (read_operand<M>() >> 1);
 
-    if (addr_mode == nes_addr_mode::nes_addr_mode_acc) {
-      A() = (C << 7) | (A() >> 1);
-      set_flag(C, A() & 0x01);
-      calc_alu_flags(A());
-    } else {
-      BYTE val = bus->cpu_read(addr_abs);
+    set_flag(C, val & 0x01);
+    calc_alu_flags(val);
+    write_operand<M>(val);
 
-      val = (C << 7) | (val >> 1);
-      set_flag(C, val & 0x01);
-      calc_alu_flags(val);
-      bus->cpu_write(addr_abs, val);
-    }
+    return 0;
   }
 
-  cycle_t NES_CPU::RTI(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
+  cycle_t NES_CPU::RTI() {
     P() = bus->cpu_read(SP()--);
     BYTE lo = bus->cpu_read(SP()--);
     BYTE hi = bus->cpu_read(SP()--);
@@ -856,24 +1239,25 @@ namespace NES_Emulator {
 
     PC() = (hi << 8) | lo;
 
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::RTS(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
+  cycle_t NES_CPU::RTS() {
     BYTE lo = bus->cpu_read(SP()--);
     BYTE hi = bus->cpu_read(SP()--);
 
     PC() = (hi << 8) | lo;
 
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::SBC(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = get_address_mode(op);
-    cycles += set_value_for_address_mode(addr_mode);
-    BYTE val = get_value_for_address_mode(addr_mode);
+  template<nes_addr_mode M>
+  cycle_t NES_CPU::SBC() {
+    /**
+     * Subtract with borrow.
+     */
+    cycle_t page_crossed = address<M>();
+    BYTE val = read_operand<M>();
 
     val = val ^ 0x00FF;
     set_flag(C, (int)A() + val > 0x00FF);
@@ -886,109 +1270,91 @@ namespace NES_Emulator {
 
     calc_alu_flags(A());
 
-    return cycles;
+    return page_crossed;
   }
 
-  cycle_t NES_CPU::SEC(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
+  cycle_t NES_CPU::SEC() {
     set_flag(C, 1);
-
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::SED(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
+  cycle_t NES_CPU::SED() {
     set_flag(D, 1);
-
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::SEI(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
+  cycle_t NES_CPU::SEI() {
     set_flag(I, 1);
-
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::STA(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = get_address_mode(op);
-    cycles += set_value_for_address_mode(addr_mode);
-    
-    bus->cpu_write(addr_abs, A());
+  template<nes_addr_mode M>
+  cycle_t NES_CPU::STA() {
+    address<M>();
+    write_operand<M>(A());
 
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::STX(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = get_address_mode(op);
-    cycles += set_value_for_address_mode(addr_mode);
-    
-    bus->cpu_write(addr_abs, X());
+  template<nes_addr_mode M>
+  cycle_t NES_CPU::STX() {
+    address<M>();
+    write_operand<M>(X());
 
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::STY(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
-    nes_addr_mode addr_mode = get_address_mode(op);
-    cycles += set_value_for_address_mode(addr_mode);
-    
-    bus->cpu_write(addr_abs, Y());
+  template<nes_addr_mode M>
+  cycle_t NES_CPU::STY() {
+    address<M>();
+    write_operand<M>(Y());
 
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::TAX(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
+  cycle_t NES_CPU::TAX() {
     X() = A();
 
     calc_alu_flags(X());
 
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::TAY(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
+  cycle_t NES_CPU::TAY() {
     Y() = A();
 
     calc_alu_flags(Y());
 
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::TSX(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
+  cycle_t NES_CPU::TSX() {
     X() = SP();
 
     calc_alu_flags(X());
 
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::TXA(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
+  cycle_t NES_CPU::TXA() {
     A() = X();
 
     calc_alu_flags(A());
 
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::TXS(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
+  cycle_t NES_CPU::TXS() {
     SP() = X();
 
-    return cycles;
+    return 0;
   }
 
-  cycle_t NES_CPU::TYA(opcode_t op) {
-    cycle_t cycles = get_cpu_cycles(op);
+  cycle_t NES_CPU::TYA() {
     A() = Y();
 
     calc_alu_flags(A());
 
-    return cycles;
+    return 0;
   }
 }
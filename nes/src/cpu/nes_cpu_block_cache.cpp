@@ -0,0 +1,44 @@
+#include "nes_cpu_block_cache.h"
+
+namespace NES_Emulator {
+  NES_CPU_Block_Cache::NES_CPU_Block_Cache() {
+  }
+
+  NES_CPU_Block_Cache::block* NES_CPU_Block_Cache::find(address_t pc, unsigned int bank) {
+    size_t table = (size_t)bank * 4 + ((pc >> 13) & 0x03);
+
+    if (table >= index.size() || index[table].empty())
+      return nullptr;
+
+    uint32_t slot = index[table][pc & 0x1FFF];
+
+    if (slot == 0)
+      return nullptr;
+
+    return &blocks[slot - 1];
+  }
+
+  NES_CPU_Block_Cache::block* NES_CPU_Block_Cache::allocate(address_t pc, unsigned int bank) {
+    size_t table = (size_t)bank * 4 + ((pc >> 13) & 0x03);
+
+    if (table >= index.size())
+      index.resize(table + 1);
+
+    if (index[table].empty())
+      index[table].resize(0x2000, 0);
+
+    uint32_t &slot = index[table][pc & 0x1FFF];
+
+    if (slot == 0) {
+      blocks.emplace_back();
+      slot = blocks.size();
+    }
+
+    return &blocks[slot - 1];
+  }
+
+  void NES_CPU_Block_Cache::clear() {
+    blocks.clear();
+    index.clear();
+  }
+}
@@ -0,0 +1,57 @@
+#include "nes.h"
+
+namespace NES_Emulator {
+  class NES_CPU;
+
+  class NES_CPU_Block_Cache {
+  public:
+    // Instruction typedef
+    typedef cycle_t (NES_CPU::*instruction)();
+
+    // Longest run of instructions decoded into one block
+    static const BYTE MAX_BLOCK_OPS = 32;
+
+    // Decoded instruction with its operand already fetched
+    struct micro_op {
+      instruction handler;
+      opcode_t opcode;
+      operand_t operand;
+      address_t next_pc;
+      cycle_t cycles;
+    };
+
+    // Straight-line PRG ROM code, ending at a branch, jump or bank edge
+    struct block {
+      micro_op ops[MAX_BLOCK_OPS];
+      BYTE length;
+      unsigned int bank;
+      unsigned int cycles;
+
+      // Hot blocks are compiled by NES_CPU_JIT
+      unsigned int executions;
+      void* native;
+    };
+
+  private:
+    // Decoded blocks
+    std::vector<block> blocks;
+
+    /**
+     * Block slot + 1 for every offset of an 8KB PRG ROM bank, 0 when nothing
+     * was decoded there. One table per bank and window it runs in, since
+     * blocks hold CPU addresses, made the first time the bank runs there.
+     * Code at the same address in different banks keeps a block for each.
+     */
+    std::vector<std::vector<uint32_t>> index;
+
+  public:
+    NES_CPU_Block_Cache();
+
+    // Lookup, by CPU address and the 8KB bank mapped there
+    block* find(address_t, unsigned int);
+    block* allocate(address_t, unsigned int);
+
+    // Invalidation
+    void clear();
+  };
+}
@@ -0,0 +1,798 @@
+#include "nes_cpu.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define NES_CPU_JIT_X86_64
+#endif
+
+namespace NES_Emulator {
+  // x86-64 opcodes for alu(), alu_imm() and shift_imm()
+  static const BYTE X86_ADD = 0x01, X86_OR = 0x09, X86_AND = 0x21, X86_SUB = 0x29, X86_XOR = 0x31;
+  static const BYTE X86_ADD_IMM = 0, X86_OR_IMM = 1, X86_AND_IMM = 4, X86_SUB_IMM = 5, X86_XOR_IMM = 6, X86_CMP_IMM = 7;
+  static const BYTE X86_SHL = 4, X86_SHR = 5;
+
+  // x86-64 condition codes
+  static const BYTE X86_B = 0x2, X86_AE = 0x3, X86_E = 0x4, X86_NE = 0x5, X86_A = 0x7;
+
+  // 6502 flags
+  static const BYTE FLAG_N = 0x80, FLAG_V = 0x40, FLAG_D = 0x08, FLAG_I = 0x04, FLAG_Z = 0x02, FLAG_C = 0x01;
+
+  NES_CPU_JIT::NES_CPU_JIT(NES_CPU* cpu) {
+    this->cpu = cpu;
+    code = nullptr;
+    code_used = 0;
+
+#ifdef NES_CPU_JIT_X86_64
+    /**
+     * Code memory is never writable and executable at once. It is mapped
+     * RW and turned RX right away, which also finds hosts that refuse
+     * executable mappings. compile() opens the pages a block lands on for
+     * writing only while copying it in.
+     */
+    void* memory = mmap(nullptr, CODE_MEMORY_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (memory != MAP_FAILED) {
+      code = (BYTE*)memory;
+
+      if (!protect(code, CODE_MEMORY_SIZE, false)) {
+        munmap(code, CODE_MEMORY_SIZE);
+        code = nullptr;
+      }
+    }
+#endif
+
+    for (int i = 0; i < 256; i++)
+      guest.nz[i] = (i & FLAG_N) | (i == 0 ? FLAG_Z : 0);
+
+    guest.cpu = cpu;
+    guest.ram = cpu->bus->get_cpu_ram();
+  }
+
+  NES_CPU_JIT::~NES_CPU_JIT() {
+#ifdef NES_CPU_JIT_X86_64
+    if (code)
+      munmap(code, CODE_MEMORY_SIZE);
+#endif
+  }
+
+  bool NES_CPU_JIT::is_supported() {
+#ifdef NES_CPU_JIT_X86_64
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  bool NES_CPU_JIT::has_code_memory() {
+    return code != nullptr;
+  }
+
+  void NES_CPU_JIT::clear() {
+    // Old code stays RX until compile() writes over it.
+    code_used = 0;
+    fallback_ops.clear();
+  }
+
+  bool NES_CPU_JIT::protect(BYTE* start, size_t size, bool writable) {
+#ifdef NES_CPU_JIT_X86_64
+    uintptr_t page = sysconf(_SC_PAGESIZE);
+    uintptr_t first = (uintptr_t)start & ~(page - 1);
+    uintptr_t end = ((uintptr_t)start + size + page - 1) & ~(page - 1);
+
+    return mprotect((void*)first, end - first, writable ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC) == 0;
+#else
+    return false;
+#endif
+  }
+
+  // Byte emitters
+  void NES_CPU_JIT::emit(BYTE b) {
+    buffer.push_back(b);
+  }
+
+  void NES_CPU_JIT::emit32(uint32_t v) {
+    for (int i = 0; i < 4; i++)
+      emit((v >> (i * 8)) & 0xFF);
+  }
+
+  void NES_CPU_JIT::emit64(uint64_t v) {
+    for (int i = 0; i < 8; i++)
+      emit((v >> (i * 8)) & 0xFF);
+  }
+
+  void NES_CPU_JIT::emit_rex(bool w, int reg, int index, int base, bool force) {
+    BYTE rex = 0x40 | (w << 3);
+
+    if (reg != NONE && (reg & 8))
+      rex |= 0x04;
+    if (index != NONE && (index & 8))
+      rex |= 0x02;
+    if (base != NONE && (base & 8))
+      rex |= 0x01;
+
+    if (rex != 0x40 || force)
+      emit(rex);
+  }
+
+  void NES_CPU_JIT::emit_mem(int reg, int base, int index, int32_t disp) {
+    // Always [base + index + disp32], with a SIB byte when indexed or based on rsp/r12.
+    if (index == NONE && (base & 7) != RSP) {
+      emit(0x80 | ((reg & 7) << 3) | (base & 7));
+    } else {
+      emit(0x80 | ((reg & 7) << 3) | RSP);
+      emit(((index == NONE ? RSP : index & 7) << 3) | (base & 7));
+    }
+
+    emit32(disp);
+  }
+
+  // x86-64 instructions
+  void NES_CPU_JIT::mov(int dst, int src) {
+    alu(0x89, dst, src);
+  }
+
+  void NES_CPU_JIT::mov64(int dst, int src) {
+    emit_rex(true, src, NONE, dst, false);
+    emit(0x89);
+    emit(0xC0 | ((src & 7) << 3) | (dst & 7));
+  }
+
+  void NES_CPU_JIT::mov_imm(int dst, uint32_t imm) {
+    emit_rex(false, NONE, NONE, dst, false);
+    emit(0xB8 + (dst & 7));
+    emit32(imm);
+  }
+
+  void NES_CPU_JIT::mov_imm64(int dst, uint64_t imm) {
+    emit_rex(true, NONE, NONE, dst, false);
+    emit(0xB8 + (dst & 7));
+    emit64(imm);
+  }
+
+  void NES_CPU_JIT::alu(BYTE op, int dst, int src) {
+    emit_rex(false, src, NONE, dst, false);
+    emit(op);
+    emit(0xC0 | ((src & 7) << 3) | (dst & 7));
+  }
+
+  void NES_CPU_JIT::alu_imm(BYTE ext, int dst, uint32_t imm) {
+    emit_rex(false, NONE, NONE, dst, false);
+    emit(0x81);
+    emit(0xC0 | (ext << 3) | (dst & 7));
+    emit32(imm);
+  }
+
+  void NES_CPU_JIT::shift_imm(BYTE ext, int dst, BYTE imm) {
+    emit_rex(false, NONE, NONE, dst, false);
+    emit(0xC1);
+    emit(0xC0 | (ext << 3) | (dst & 7));
+    emit(imm);
+  }
+
+  void NES_CPU_JIT::movzx8(int dst, int src) {
+    emit_rex(false, dst, NONE, src, true);
+    emit(0x0F);
+    emit(0xB6);
+    emit(0xC0 | ((dst & 7) << 3) | (src & 7));
+  }
+
+  void NES_CPU_JIT::setcc(BYTE cc, int dst) {
+    emit_rex(false, NONE, NONE, dst, true);
+    emit(0x0F);
+    emit(0x90 + cc);
+    emit(0xC0 | (dst & 7));
+  }
+
+  void NES_CPU_JIT::load32(int dst, int base, int32_t disp) {
+    emit_rex(false, dst, NONE, base, false);
+    emit(0x8B);
+    emit_mem(dst, base, NONE, disp);
+  }
+
+  void NES_CPU_JIT::load64(int dst, int base, int32_t disp) {
+    emit_rex(true, dst, NONE, base, false);
+    emit(0x8B);
+    emit_mem(dst, base, NONE, disp);
+  }
+
+  void NES_CPU_JIT::store32(int base, int32_t disp, int src) {
+    emit_rex(false, src, NONE, base, false);
+    emit(0x89);
+    emit_mem(src, base, NONE, disp);
+  }
+
+  void NES_CPU_JIT::store32_imm(int base, int32_t disp, uint32_t imm) {
+    emit_rex(false, NONE, NONE, base, false);
+    emit(0xC7);
+    emit_mem(0, base, NONE, disp);
+    emit32(imm);
+  }
+
+  void NES_CPU_JIT::load8(int dst, int base, int index, int32_t disp) {
+    emit_rex(false, dst, index, base, false);
+    emit(0x0F);
+    emit(0xB6);
+    emit_mem(dst, base, index, disp);
+  }
+
+  void NES_CPU_JIT::store8(int base, int index, int32_t disp, int src) {
+    emit_rex(false, src, index, base, true);
+    emit(0x88);
+    emit_mem(src, base, index, disp);
+  }
+
+  void NES_CPU_JIT::cmp_mem(int dst, int base, int32_t disp) {
+    emit_rex(false, dst, NONE, base, false);
+    emit(0x3B);
+    emit_mem(dst, base, NONE, disp);
+  }
+
+  void NES_CPU_JIT::test_imm(int dst, uint32_t imm) {
+    emit_rex(false, NONE, NONE, dst, false);
+    emit(0xF7);
+    emit(0xC0 | (dst & 7));
+    emit32(imm);
+  }
+
+  void NES_CPU_JIT::push(int r) {
+    emit_rex(false, NONE, NONE, r, false);
+    emit(0x50 + (r & 7));
+  }
+
+  void NES_CPU_JIT::pop(int r) {
+    emit_rex(false, NONE, NONE, r, false);
+    emit(0x58 + (r & 7));
+  }
+
+  void NES_CPU_JIT::call(const void* function) {
+    mov_imm64(RAX, (uint64_t)function);
+    emit(0xFF);
+    emit(0xD0);
+  }
+
+  size_t NES_CPU_JIT::jcc(BYTE cc) {
+    emit(0x0F);
+    emit(0x80 + cc);
+    emit32(0);
+    return buffer.size() - 4;
+  }
+
+  size_t NES_CPU_JIT::jmp() {
+    emit(0xE9);
+    emit32(0);
+    return buffer.size() - 4;
+  }
+
+  void NES_CPU_JIT::patch(size_t at, size_t target) {
+    uint32_t rel = (uint32_t)(target - (at + 4));
+
+    for (int i = 0; i < 4; i++)
+      buffer[at + i] = (rel >> (i * 8)) & 0xFF;
+  }
+
+  // Guest helpers
+  void NES_CPU_JIT::load_registers() {
+    load32(R12, RBP, offsetof(state, a));
+    load32(R13, RBP, offsetof(state, x));
+    load32(R14, RBP, offsetof(state, y));
+    load32(R15, RBP, offsetof(state, p));
+    load32(RBX, RBP, offsetof(state, cycles));
+  }
+
+  void NES_CPU_JIT::store_registers() {
+    store32(RBP, offsetof(state, a), R12);
+    store32(RBP, offsetof(state, x), R13);
+    store32(RBP, offsetof(state, y), R14);
+    store32(RBP, offsetof(state, p), R15);
+    store32(RBP, offsetof(state, cycles), RBX);
+  }
+
+  void NES_CPU_JIT::exit_to(address_t pc) {
+    store32_imm(RBP, offsetof(state, pc), pc);
+    exits.push_back(jmp());
+  }
+
+  void NES_CPU_JIT::update_nz(int reg) {
+    alu_imm(X86_AND_IMM, R15, 0xFF & ~(FLAG_N | FLAG_Z));
+    load8(RDX, RBP, reg, offsetof(state, nz));
+    alu(X86_OR, R15, RDX);
+  }
+
+  void NES_CPU_JIT::add_with_flags(int reg, bool store) {
+    /**
+     * reg + eax with the carry and overflow rules of compare(), ADC and SBC.
+     */
+    mov(RCX, reg);
+    alu(X86_ADD, RCX, RAX);
+    alu_imm(X86_AND_IMM, R15, 0xFF & ~(FLAG_C | FLAG_V));
+
+    // C when the sum leaves the byte.
+    alu_imm(X86_CMP_IMM, RCX, 0xFF);
+    setcc(X86_A, RDX);
+    movzx8(RDX, RDX);
+    alu(X86_OR, R15, RDX);
+
+    // V when two positive operands give a negative sum.
+    mov(RDX, reg);
+    alu(X86_OR, RDX, RAX);
+    alu_imm(X86_XOR_IMM, RDX, 0xFFFFFFFF);
+    alu(X86_AND, RDX, RCX);
+    alu_imm(X86_AND_IMM, RDX, 0x80);
+    shift_imm(X86_SHR, RDX, 1);
+    alu(X86_OR, R15, RDX);
+
+    movzx8(store ? reg : RCX, RCX);
+    update_nz(store ? reg : RCX);
+  }
+
+  bool NES_CPU_JIT::ram_address(const NES_CPU_Block_Cache::micro_op &op, nes_addr_mode addr_mode) {
+    /**
+     * Point rcx (+ mem_index) + mem_disp at the operand when it is known to be
+     * in CPU RAM, without emitting anything otherwise.
+     */
+    mem_index = NONE;
+    mem_disp = 0;
+
+    switch (addr_mode) {
+      case nes_addr_mode_zp:
+        mem_disp = op.operand & 0x00FF;
+        break;
+      case nes_addr_mode_zp_x:
+      case nes_addr_mode_zp_y:
+        mov(RDX, addr_mode == nes_addr_mode_zp_x ? R13 : R14);
+        alu_imm(X86_ADD_IMM, RDX, op.operand & 0x00FF);
+        alu_imm(X86_AND_IMM, RDX, 0x00FF);
+        mem_index = RDX;
+        break;
+      case nes_addr_mode_abs:
+        if (op.operand > 0x1FFF)
+          return false;
+        mem_disp = op.operand & 0x07FF;
+        break;
+      case nes_addr_mode_abs_x:
+      case nes_addr_mode_abs_y:
+        if (op.operand + 0xFF > 0x1FFF)
+          return false;
+        mov(RDX, addr_mode == nes_addr_mode_abs_x ? R13 : R14);
+        alu_imm(X86_ADD_IMM, RDX, op.operand);
+        alu_imm(X86_AND_IMM, RDX, 0x07FF);
+        mem_index = RDX;
+        break;
+      default:
+        return false;
+    }
+
+    load64(RCX, RBP, offsetof(state, ram));
+    return true;
+  }
+
+  void NES_CPU_JIT::bus_address(const NES_CPU_Block_Cache::micro_op &op, nes_addr_mode addr_mode) {
+    if (addr_mode == nes_addr_mode_abs) {
+      mov_imm(RSI, op.operand);
+    } else {
+      mov(RSI, addr_mode == nes_addr_mode_abs_x ? R13 : R14);
+      alu_imm(X86_ADD_IMM, RSI, op.operand);
+      alu_imm(X86_AND_IMM, RSI, 0xFFFF);
+    }
+
+    mov64(RDI, RBP);
+  }
+
+  bool NES_CPU_JIT::load_operand(const NES_CPU_Block_Cache::micro_op &op, nes_addr_mode addr_mode) {
+    /**
+     * Operand value into eax, with the page crossing cycle when the opcode
+     * table says the instruction takes one.
+     */
+    switch (addr_mode) {
+      case nes_addr_mode_imm:
+        mov_imm(RAX, op.operand & 0x00FF);
+        return true;
+      case nes_addr_mode_zp:
+      case nes_addr_mode_zp_x:
+      case nes_addr_mode_zp_y:
+      case nes_addr_mode_abs:
+      case nes_addr_mode_abs_x:
+      case nes_addr_mode_abs_y:
+        break;
+      default:
+        return false;
+    }
+
+    if (NES_CPU::OPCODE_TABLE[op.opcode].page_penalty && (addr_mode == nes_addr_mode_abs_x || addr_mode == nes_addr_mode_abs_y)) {
+      mov(RDX, addr_mode == nes_addr_mode_abs_x ? R13 : R14);
+      alu_imm(X86_ADD_IMM, RDX, op.operand);
+      shift_imm(X86_SHR, RDX, 8);
+      alu_imm(X86_CMP_IMM, RDX, op.operand >> 8);
+      setcc(X86_NE, RDX);
+      movzx8(RDX, RDX);
+      alu(X86_ADD, RBX, RDX);
+    }
+
+    if (ram_address(op, addr_mode)) {
+      load8(RAX, RCX, mem_index, mem_disp);
+    } else {
+      bus_address(op, addr_mode);
+      store32(RBP, offsetof(state, cycles), RBX);
+      call((const void*)&NES_CPU_JIT::read);
+    }
+
+    return true;
+  }
+
+  bool NES_CPU_JIT::store_operand(const NES_CPU_Block_Cache::micro_op &op, nes_addr_mode addr_mode, int src) {
+    switch (addr_mode) {
+      case nes_addr_mode_zp:
+      case nes_addr_mode_zp_x:
+      case nes_addr_mode_zp_y:
+      case nes_addr_mode_abs:
+      case nes_addr_mode_abs_x:
+      case nes_addr_mode_abs_y:
+        break;
+      default:
+        return false;
+    }
+
+    if (ram_address(op, addr_mode)) {
+      store8(RCX, mem_index, mem_disp, src);
+    } else {
+      bus_address(op, addr_mode);
+      mov(RDX, src);
+      store32(RBP, offsetof(state, cycles), RBX);
+      call((const void*)&NES_CPU_JIT::write);
+
+      // DMA may have stalled the CPU.
+      load32(RBX, RBP, offsetof(state, cycles));
+
+      // The write may have switched PRG banks.
+      check_generation = true;
+    }
+
+    return true;
+  }
+
+  void NES_CPU_JIT::finish_op(const NES_CPU_Block_Cache::micro_op &op, bool last) {
+    alu_imm(X86_ADD_IMM, RBX, op.cycles);
+
+    if (last)
+      return;
+
+    if (check_generation) {
+      test_imm(RAX, 0xFFFFFFFF);
+      size_t same_bank = jcc(X86_E);
+      exit_to(op.next_pc);
+      patch(same_bank, buffer.size());
+    }
+
+    cmp_mem(RBX, RBP, offsetof(state, budget));
+    size_t in_budget = jcc(X86_B);
+    exit_to(op.next_pc);
+    patch(in_budget, buffer.size());
+  }
+
+  bool NES_CPU_JIT::compile_op(const NES_CPU_Block_Cache::micro_op &op, bool last) {
+    nes_addr_mode addr_mode = NES_CPU::OPCODE_TABLE[op.opcode].addr_mode;
+    check_generation = false;
+
+    // Unofficial opcodes share the NOP handler.
+    if (op.handler == &NES_CPU::NOP) {
+      finish_op(op, last);
+      return true;
+    }
+
+    switch (op.opcode) {
+      // LDA, LDX, LDY
+      case 0xA9: case 0xA5: case 0xB5: case 0xAD: case 0xBD: case 0xB9:
+      case 0xA2: case 0xA6: case 0xB6: case 0xAE: case 0xBE:
+      case 0xA0: case 0xA4: case 0xB4: case 0xAC: case 0xBC: {
+        if (!load_operand(op, addr_mode))
+          return false;
+
+        int reg = (op.opcode & 0x03) == 0x01 ? R12 : (op.opcode & 0x03) == 0x02 ? R13 : R14;
+        mov(reg, RAX);
+        update_nz(reg);
+        break;
+      }
+
+      // STA, STX, STY
+      case 0x85: case 0x95: case 0x8D: case 0x9D: case 0x99:
+      case 0x86: case 0x96: case 0x8E:
+      case 0x84: case 0x94: case 0x8C: {
+        int reg = (op.opcode & 0x03) == 0x01 ? R12 : (op.opcode & 0x03) == 0x02 ? R13 : R14;
+
+        if (!store_operand(op, addr_mode, reg))
+          return false;
+        break;
+      }
+
+      // AND, ORA, EOR
+      case 0x29: case 0x25: case 0x35: case 0x2D: case 0x3D: case 0x39:
+      case 0x09: case 0x05: case 0x15: case 0x0D: case 0x1D: case 0x19:
+      case 0x49: case 0x45: case 0x55: case 0x4D: case 0x5D: case 0x59:
+        if (!load_operand(op, addr_mode))
+          return false;
+
+        alu((op.opcode & 0xE0) == 0x20 ? X86_AND : (op.opcode & 0xE0) == 0x00 ? X86_OR : X86_XOR, R12, RAX);
+        update_nz(R12);
+        break;
+
+      // ADC, SBC
+      case 0x69: case 0x65: case 0x75: case 0x6D: case 0x7D: case 0x79:
+      case 0xE9: case 0xE5: case 0xF5: case 0xED: case 0xFD: case 0xF9:
+        if (!load_operand(op, addr_mode))
+          return false;
+
+        if (op.opcode >= 0xE0)
+          alu_imm(X86_XOR_IMM, RAX, 0xFF);
+
+        add_with_flags(R12, true);
+        break;
+
+      // CMP, CPX, CPY
+      case 0xC9: case 0xC5: case 0xD5: case 0xCD: case 0xDD: case 0xD9:
+      case 0xE0: case 0xE4: case 0xEC:
+      case 0xC0: case 0xC4: case 0xCC: {
+        if (!load_operand(op, addr_mode))
+          return false;
+
+        alu_imm(X86_XOR_IMM, RAX, 0xFF);
+        add_with_flags((op.opcode & 0x03) == 0x01 ? R12 : op.opcode >= 0xE0 ? R13 : R14, false);
+        break;
+      }
+
+      // BIT
+      case 0x24: case 0x2C:
+        if (!load_operand(op, addr_mode))
+          return false;
+
+        mov(RCX, R12);
+        alu(X86_AND, RCX, RAX);
+        update_nz(RCX);
+        alu_imm(X86_AND_IMM, R15, 0xFF & ~(FLAG_N | FLAG_V));
+        mov(RDX, RAX);
+        alu_imm(X86_AND_IMM, RDX, FLAG_N | FLAG_V);
+        alu(X86_OR, R15, RDX);
+        break;
+
+      // INC, DEC on RAM
+      case 0xE6: case 0xF6: case 0xEE: case 0xFE:
+      case 0xC6: case 0xD6: case 0xCE: case 0xDE:
+        if (!ram_address(op, addr_mode))
+          return false;
+
+        load8(RAX, RCX, mem_index, mem_disp);
+        alu_imm(op.opcode >= 0xE0 ? X86_ADD_IMM : X86_SUB_IMM, RAX, 1);
+        alu_imm(X86_AND_IMM, RAX, 0xFF);
+        store8(RCX, mem_index, mem_disp, RAX);
+        update_nz(RAX);
+        break;
+
+      // ASL, LSR, ROL, ROR on the accumulator
+      case 0x0A: case 0x4A: case 0x2A: case 0x6A:
+        alu_imm(X86_AND_IMM, R15, 0xFF & ~FLAG_C);
+
+        if (op.opcode == 0x6A) {
+          shift_imm(X86_SHR, R12, 1);
+          alu_imm(X86_OR_IMM, R12, 0x80);
+        }
+
+        mov(RDX, R12);
+
+        if (op.opcode == 0x0A || op.opcode == 0x2A)
+          shift_imm(X86_SHR, RDX, 7);
+        else
+          alu_imm(X86_AND_IMM, RDX, 0x01);
+
+        alu(X86_OR, R15, RDX);
+
+        if (op.opcode == 0x0A || op.opcode == 0x2A) {
+          shift_imm(X86_SHL, R12, 1);
+          if (op.opcode == 0x2A)
+            alu_imm(X86_OR_IMM, R12, FLAG_C);
+          alu_imm(X86_AND_IMM, R12, 0xFF);
+        } else if (op.opcode == 0x4A) {
+          shift_imm(X86_SHR, R12, 1);
+        }
+
+        update_nz(R12);
+        break;
+
+      // INX, INY, DEX, DEY
+      case 0xE8: case 0xC8: case 0xCA: case 0x88: {
+        int reg = op.opcode == 0xE8 || op.opcode == 0xCA ? R13 : R14;
+
+        alu_imm(op.opcode == 0xE8 || op.opcode == 0xC8 ? X86_ADD_IMM : X86_SUB_IMM, reg, 1);
+        alu_imm(X86_AND_IMM, reg, 0xFF);
+        update_nz(reg);
+        break;
+      }
+
+      // Transfers
+      case 0xAA: mov(R13, R12); update_nz(R13); break;
+      case 0xA8: mov(R14, R12); update_nz(R14); break;
+      case 0x8A: mov(R12, R13); update_nz(R12); break;
+      case 0x98: mov(R12, R14); update_nz(R12); break;
+      case 0x9A: store32(RBP, offsetof(state, sp), R13); break;
+      case 0xBA: load32(R13, RBP, offsetof(state, sp)); update_nz(R13); break;
+
+      // Flags
+      case 0x18: alu_imm(X86_AND_IMM, R15, 0xFF & ~FLAG_C); break;
+      case 0x38: alu_imm(X86_OR_IMM, R15, FLAG_C); break;
+      case 0x58: alu_imm(X86_AND_IMM, R15, 0xFF & ~FLAG_I); break;
+      case 0x78: alu_imm(X86_OR_IMM, R15, FLAG_I); break;
+      case 0xB8: alu_imm(X86_AND_IMM, R15, 0xFF & ~FLAG_V); break;
+      case 0xD8: alu_imm(X86_AND_IMM, R15, 0xFF & ~FLAG_D); break;
+      case 0xF8: alu_imm(X86_OR_IMM, R15, FLAG_D); break;
+
+      // Branches end the block on both paths.
+      case 0x10: case 0x30: case 0x50: case 0x70:
+      case 0x90: case 0xB0: case 0xD0: case 0xF0: {
+        static const BYTE BRANCH_FLAGS[4] = { FLAG_N, FLAG_V, FLAG_C, FLAG_Z };
+        address_t target = op.next_pc + (address_t)(int8_t)(op.operand & 0x00FF);
+        cycle_t taken_cycles = op.cycles + 1 + ((target >> 8) != (op.next_pc >> 8));
+
+        test_imm(R15, BRANCH_FLAGS[op.opcode >> 6]);
+        size_t not_taken = jcc((op.opcode & 0x20) ? X86_E : X86_NE);
+        alu_imm(X86_ADD_IMM, RBX, taken_cycles);
+        exit_to(target);
+
+        patch(not_taken, buffer.size());
+        alu_imm(X86_ADD_IMM, RBX, op.cycles);
+        exit_to(op.next_pc);
+        return true;
+      }
+
+      // JMP absolute
+      case 0x4C:
+        alu_imm(X86_ADD_IMM, RBX, op.cycles);
+        exit_to(op.operand);
+        return true;
+
+      default:
+        return false;
+    }
+
+    finish_op(op, last);
+    return true;
+  }
+
+  void NES_CPU_JIT::compile_fallback(const NES_CPU_Block_Cache::micro_op &op, bool last) {
+    /**
+     * Hand the instruction to its interpreter handler. The helper leaves the
+     * next PC in the guest state, so any exit from here just leaves the block.
+     */
+    fallback_ops.push_back(op);
+
+    store_registers();
+    mov64(RDI, RBP);
+    mov_imm64(RSI, (uint64_t)&fallback_ops.back());
+    call((const void*)&NES_CPU_JIT::interpret);
+    load_registers();
+
+    if (last) {
+      exits.push_back(jmp());
+      return;
+    }
+
+    test_imm(RAX, 0xFFFFFFFF);
+    exits.push_back(jcc(X86_NE));
+    cmp_mem(RBX, RBP, offsetof(state, budget));
+    exits.push_back(jcc(X86_AE));
+  }
+
+  NES_CPU_JIT::native_block NES_CPU_JIT::compile(const NES_CPU_Block_Cache::block &block) {
+#ifdef NES_CPU_JIT_X86_64
+    buffer.clear();
+    exits.clear();
+
+    // Prologue, with sub rsp, 8 keeping the stack 16 byte aligned for helper calls.
+    push(RBX); push(RBP); push(R12); push(R13); push(R14); push(R15);
+    emit(0x48); emit(0x83); emit(0xEC); emit(0x08);
+    mov64(RBP, RDI);
+    load_registers();
+
+    for (BYTE i = 0; i < block.length; i++) {
+      const NES_CPU_Block_Cache::micro_op &op = block.ops[i];
+      bool last = i + 1 == block.length;
+
+      if (!compile_op(op, last))
+        compile_fallback(op, last);
+    }
+
+    exit_to(block.ops[block.length - 1].next_pc);
+
+    // Epilogue, ending in add rsp, 8
+    for (size_t at : exits)
+      patch(at, buffer.size());
+
+    store_registers();
+    emit(0x48); emit(0x83); emit(0xC4); emit(0x08);
+    pop(R15); pop(R14); pop(R13); pop(R12); pop(RBP); pop(RBX);
+    emit(0xC3);
+
+    if (!code || code_used + buffer.size() > CODE_MEMORY_SIZE)
+      return nullptr;
+
+    // Jumps were patched in the buffer, the copy is the only write to code memory.
+    BYTE* entry = code + code_used;
+
+    if (!protect(entry, buffer.size(), true))
+      return nullptr;
+
+    memcpy(entry, buffer.data(), buffer.size());
+
+    if (!protect(entry, buffer.size(), false))
+      return nullptr;
+
+    code_used += buffer.size();
+
+    return (native_block)entry;
+#else
+    return nullptr;
+#endif
+  }
+
+  unsigned int NES_CPU_JIT::run(const NES_CPU_Block_Cache::block &block, unsigned int elapsed, unsigned int budget, const unsigned int &bank_generation) {
+    guest.a = cpu->A();
+    guest.x = cpu->X();
+    guest.y = cpu->Y();
+    guest.p = cpu->P();
+    guest.sp = cpu->SP();
+    guest.cycles = elapsed;
+    guest.budget = budget;
+    guest.generation = bank_generation;
+    guest.bank_generation = &bank_generation;
+
+    ((native_block)block.native)(&guest);
+
+    cpu->A() = guest.a;
+    cpu->X() = guest.x;
+    cpu->Y() = guest.y;
+    cpu->P() = guest.p;
+    cpu->SP() = guest.sp;
+    cpu->PC() = guest.pc;
+
+    return guest.cycles;
+  }
+
+  // Called from generated code
+  uint32_t NES_CPU_JIT::read(state* s, uint32_t address) {
+    s->cpu->batch_cycles = s->cycles;
+    return s->cpu->bus->cpu_read(address);
+  }
+
+  uint32_t NES_CPU_JIT::write(state* s, uint32_t address, uint32_t value) {
+    s->cpu->batch_cycles = s->cycles;
+    s->cpu->bus->cpu_write(address, value);
+    s->cycles = s->cpu->batch_cycles;
+    s->budget = s->cpu->batch_budget;
+
+    return *s->bank_generation != s->generation;
+  }
+
+  uint32_t NES_CPU_JIT::interpret(state* s, const NES_CPU_Block_Cache::micro_op* op) {
+    NES_CPU* cpu = s->cpu;
+
+    cpu->A() = s->a;
+    cpu->X() = s->x;
+    cpu->Y() = s->y;
+    cpu->P() = s->p;
+    cpu->SP() = s->sp;
+    cpu->operand = op->operand;
+    cpu->PC() = op->next_pc;
+    cpu->batch_cycles = s->cycles;
+
+    cycle_t cycles = op->cycles + (cpu->*op->handler)();
+    s->cycles = cpu->batch_cycles + cycles;
+    s->budget = cpu->batch_budget;
+
+    s->a = cpu->A();
+    s->x = cpu->X();
+    s->y = cpu->Y();
+    s->p = cpu->P();
+    s->sp = cpu->SP();
+    s->pc = cpu->PC();
+
+    return *s->bank_generation != s->generation;
+  }
+}
@@ -0,0 +1,130 @@
+#include "nes.h"
+#include "nes_cpu_block_cache.h"
+
+namespace NES_Emulator {
+  class NES_CPU;
+
+  class NES_CPU_JIT {
+  public:
+    // Guest state shared with generated code. Registers are widened to 32 bits
+    // so they load straight into host registers.
+    struct state {
+      uint32_t a;
+      uint32_t x;
+      uint32_t y;
+      uint32_t p;
+      uint32_t sp;
+      uint32_t pc;
+      uint32_t cycles;
+      uint32_t budget;
+      uint32_t generation;
+
+      // N and Z flags for every result byte
+      BYTE nz[256];
+
+      NES_CPU* cpu;
+      BYTE* ram;
+      const unsigned int* bank_generation;
+    };
+
+    typedef void (*native_block)(state*);
+
+    // Executions through the block cache before a block is compiled
+    static const unsigned int HOT_BLOCK_EXECUTIONS = 16;
+
+  private:
+    // Executable memory, RX except while a block is copied in
+    static const size_t CODE_MEMORY_SIZE = 4 * 1024 * 1024;
+    BYTE* code;
+    size_t code_used;
+
+    bool protect(BYTE*, size_t, bool);
+
+    // Guest state
+    NES_CPU* cpu;
+    state guest;
+
+    // Micro-ops handed back to the interpreter by generated code
+    std::deque<NES_CPU_Block_Cache::micro_op> fallback_ops;
+
+    // Emitter
+    std::vector<BYTE> buffer;
+    std::vector<size_t> exits;
+    bool check_generation;
+    int mem_index;
+    int32_t mem_disp;
+
+    // Host registers
+    enum host_register {
+      RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+      R8, R9, R10, R11, R12, R13, R14, R15,
+      NONE = -1
+    };
+
+    // Byte emitters
+    void emit(BYTE);
+    void emit32(uint32_t);
+    void emit64(uint64_t);
+    void emit_rex(bool, int, int, int, bool);
+    void emit_mem(int, int, int, int32_t);
+
+    // x86-64 instructions
+    void mov(int, int);
+    void mov64(int, int);
+    void mov_imm(int, uint32_t);
+    void mov_imm64(int, uint64_t);
+    void alu(BYTE, int, int);
+    void alu_imm(BYTE, int, uint32_t);
+    void shift_imm(BYTE, int, BYTE);
+    void movzx8(int, int);
+    void setcc(BYTE, int);
+    void load32(int, int, int32_t);
+    void load64(int, int, int32_t);
+    void store32(int, int32_t, int);
+    void store32_imm(int, int32_t, uint32_t);
+    void load8(int, int, int, int32_t);
+    void store8(int, int, int32_t, int);
+    void cmp_mem(int, int, int32_t);
+    void test_imm(int, uint32_t);
+    void push(int);
+    void pop(int);
+    void call(const void*);
+    size_t jcc(BYTE);
+    size_t jmp();
+    void patch(size_t, size_t);
+
+    // Guest helpers
+    void load_registers();
+    void store_registers();
+    void exit_to(address_t);
+    void update_nz(int);
+    void add_with_flags(int, bool);
+    bool ram_address(const NES_CPU_Block_Cache::micro_op&, nes_addr_mode);
+    void bus_address(const NES_CPU_Block_Cache::micro_op&, nes_addr_mode);
+    bool load_operand(const NES_CPU_Block_Cache::micro_op&, nes_addr_mode);
+    bool store_operand(const NES_CPU_Block_Cache::micro_op&, nes_addr_mode, int);
+    bool compile_op(const NES_CPU_Block_Cache::micro_op&, bool);
+    void compile_fallback(const NES_CPU_Block_Cache::micro_op&, bool);
+    void finish_op(const NES_CPU_Block_Cache::micro_op&, bool);
+
+    // Called from generated code
+    static uint32_t read(state*, uint32_t);
+    static uint32_t write(state*, uint32_t, uint32_t);
+    static uint32_t interpret(state*, const NES_CPU_Block_Cache::micro_op*);
+
+  public:
+    NES_CPU_JIT(NES_CPU*);
+    ~NES_CPU_JIT();
+
+    // Host support
+    static bool is_supported();
+    bool has_code_memory();
+
+    // Compile and run
+    native_block compile(const NES_CPU_Block_Cache::block&);
+    unsigned int run(const NES_CPU_Block_Cache::block&, unsigned int, unsigned int, const unsigned int&);
+
+    // Invalidation
+    void clear();
+  };
+}
@@ -0,0 +1,11 @@
+#include "nes_mapper_cnrom.h"
+
+namespace NES_Emulator {
+  NES_Mapper_CNROM::NES_Mapper_CNROM(uint32_t prg_size, uint32_t chr_size, mirror_mode mirror) : NES_Mapper(prg_size, chr_size, mirror) {
+  }
+
+  void NES_Mapper_CNROM::cpu_write(address_t, BYTE val) {
+    // Any write selects the CHR bank, bus conflicts are not emulated.
+    set_chr_8k(val);
+  }
+}
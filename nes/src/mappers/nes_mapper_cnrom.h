@@ -0,0 +1,12 @@
+#include "nes.h"
+#include "nes_mapper.h"
+
+namespace NES_Emulator {
+  // Mapper 3: fixed PRG ROM, 8KB switchable CHR ROM bank
+  class NES_Mapper_CNROM : public NES_Mapper {
+  public:
+    NES_Mapper_CNROM(uint32_t, uint32_t, mirror_mode);
+
+    void cpu_write(address_t, BYTE) override;
+  };
+}
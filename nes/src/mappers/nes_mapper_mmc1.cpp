@@ -0,0 +1,98 @@
+#include "nes_mapper_mmc1.h"
+
+namespace NES_Emulator {
+  NES_Mapper_MMC1::NES_Mapper_MMC1(uint32_t prg_size, uint32_t chr_size, mirror_mode mirror) : NES_Mapper(prg_size, chr_size, mirror) {
+    shift = 0;
+    shift_count = 0;
+
+    // Powers up with the last PRG bank fixed at $C000.
+    control = 0x0C;
+    chr_bank0 = 0;
+    chr_bank1 = 0;
+    prg_bank = 0;
+
+    update_banks();
+  }
+
+  void NES_Mapper_MMC1::cpu_write(address_t address, BYTE val) {
+    // Bit 7 resets the shift register and goes back to the fixed last bank.
+    if (val & 0x80) {
+      shift = 0;
+      shift_count = 0;
+      control |= 0x0C;
+      update_banks();
+      return;
+    }
+
+    // Bits arrive low bit first, the fifth write picks the register by address.
+    shift |= (val & 0x01) << shift_count;
+
+    if (++shift_count < 5)
+      return;
+
+    switch (address & 0xE000) {
+      case 0x8000:
+        control = shift;
+        break;
+      case 0xA000:
+        chr_bank0 = shift;
+        break;
+      case 0xC000:
+        chr_bank1 = shift;
+        break;
+      case 0xE000:
+        prg_bank = shift & 0x0F;
+        break;
+    }
+
+    shift = 0;
+    shift_count = 0;
+    update_banks();
+  }
+
+  void NES_Mapper_MMC1::serialize(NES_State &state) {
+    NES_Mapper::serialize(state);
+
+    state.value(shift);
+    state.value(shift_count);
+    state.value(control);
+    state.value(chr_bank0);
+    state.value(chr_bank1);
+    state.value(prg_bank);
+  }
+
+  void NES_Mapper_MMC1::update_banks() {
+    static const mirror_mode MIRRORING[4] = { ONE_SCREEN_LO, ONE_SCREEN_HI, VERTICAL, HORIZONTAL };
+    set_mirror(MIRRORING[control & 0x03]);
+
+    // 512KB boards (SUROM) use CHR bank bit 4 to pick the 256KB half of PRG ROM.
+    unsigned int outer = number_prg_banks > 16 ? chr_bank0 & 0x10 : 0;
+    unsigned int last = (number_prg_banks - 1) & 0x0F;
+
+    switch ((control >> 2) & 0x03) {
+      // 32KB, low bit of the bank number ignored
+      case 0:
+      case 1:
+        set_prg_32k((outer | prg_bank) >> 1);
+        break;
+      // First bank fixed at $8000
+      case 2:
+        set_prg_16k(0, outer);
+        set_prg_16k(1, outer | prg_bank);
+        break;
+      // Last bank fixed at $C000
+      case 3:
+        set_prg_16k(0, outer | prg_bank);
+        set_prg_16k(1, outer | last);
+        break;
+    }
+
+    if (control & 0x10) {
+      set_chr_4k(0, chr_bank0);
+      set_chr_4k(1, chr_bank1);
+    }
+    else {
+      set_chr_8k(chr_bank0 >> 1);
+    }
+  }
+}
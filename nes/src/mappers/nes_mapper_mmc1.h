@@ -0,0 +1,26 @@
+#include "nes.h"
+#include "nes_mapper.h"
+
+namespace NES_Emulator {
+  // Mapper 1: registers loaded a bit at a time through a serial shift register
+  class NES_Mapper_MMC1 : public NES_Mapper {
+  private:
+    // Serial port
+    BYTE shift;
+    BYTE shift_count;
+
+    // Registers
+    BYTE control;
+    BYTE chr_bank0;
+    BYTE chr_bank1;
+    BYTE prg_bank;
+
+    void update_banks();
+
+  public:
+    NES_Mapper_MMC1(uint32_t, uint32_t, mirror_mode);
+
+    void cpu_write(address_t, BYTE) override;
+    void serialize(NES_State&) override;
+  };
+}
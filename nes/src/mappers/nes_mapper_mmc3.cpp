@@ -0,0 +1,116 @@
+#include "nes_mapper_mmc3.h"
+
+namespace NES_Emulator {
+  NES_Mapper_MMC3::NES_Mapper_MMC3(uint32_t prg_size, uint32_t chr_size, mirror_mode mirror) : NES_Mapper(prg_size, chr_size, mirror) {
+    bank_select = 0;
+
+    for (int i = 0; i < 8; i++)
+      registers[i] = 0;
+
+    irq_latch = 0;
+    irq_counter = 0;
+    irq_reload = false;
+    irq_enabled = false;
+
+    update_banks();
+  }
+
+  void NES_Mapper_MMC3::cpu_write(address_t address, BYTE val) {
+    // Four register pairs, even and odd addresses in each 8KB window.
+    switch (address & 0xE001) {
+      case 0x8000:
+        bank_select = val;
+        break;
+      case 0x8001:
+        registers[bank_select & 0x07] = val;
+        break;
+      case 0xA000:
+        set_mirror(val & 0x01 ? HORIZONTAL : VERTICAL);
+        break;
+      // PRG RAM protect, not emulated
+      case 0xA001:
+        break;
+      case 0xC000:
+        irq_latch = val;
+        break;
+      case 0xC001:
+        irq_counter = 0;
+        irq_reload = true;
+        break;
+      // Disabling also acknowledges a pending IRQ.
+      case 0xE000:
+        irq_enabled = false;
+        irq = false;
+        break;
+      case 0xE001:
+        irq_enabled = true;
+        break;
+    }
+
+    update_banks();
+  }
+
+  void NES_Mapper_MMC3::serialize(NES_State &state) {
+    NES_Mapper::serialize(state);
+
+    state.value(bank_select);
+    state.bytes(registers, sizeof(registers));
+    state.value(irq_latch);
+    state.value(irq_counter);
+    state.value(irq_reload);
+    state.value(irq_enabled);
+  }
+
+  void NES_Mapper_MMC3::update_banks() {
+    unsigned int second_last = number_prg_banks * 2 - 2;
+
+    // Bit 6 swaps the switchable $8000 bank with the fixed second to last one at $C000.
+    if (bank_select & 0x40) {
+      set_prg_8k(0, second_last);
+      set_prg_8k(2, registers[6]);
+    }
+    else {
+      set_prg_8k(0, registers[6]);
+      set_prg_8k(2, second_last);
+    }
+
+    set_prg_8k(1, registers[7]);
+    set_prg_8k(3, second_last + 1);
+
+    // Bit 7 swaps the 2KB banks at $0000 with the 1KB banks at $1000.
+    unsigned int inversion = bank_select & 0x80 ? 4 : 0;
+
+    set_chr_1k(inversion + 0, registers[0] & 0xFE);
+    set_chr_1k(inversion + 1, registers[0] | 0x01);
+    set_chr_1k(inversion + 2, registers[1] & 0xFE);
+    set_chr_1k(inversion + 3, registers[1] | 0x01);
+
+    for (unsigned int i = 0; i < 4; i++)
+      set_chr_1k((inversion ^ 4) + i, registers[2 + i]);
+  }
+
+  void NES_Mapper_MMC3::scanline() {
+    if (irq_counter == 0 || irq_reload) {
+      irq_counter = irq_latch;
+      irq_reload = false;
+    }
+    else {
+      irq_counter--;
+    }
+
+    if (irq_counter == 0 && irq_enabled)
+      irq = true;
+  }
+
+  unsigned int NES_Mapper_MMC3::get_irq_scanlines() {
+    // A raised line stays up until acknowledged, there is no later edge to predict.
+    if (!irq_enabled || irq)
+      return 0;
+
+    // Counts down to 0 from where it is, or reloads first and then counts down the latch.
+    if (irq_counter == 0 || irq_reload)
+      return irq_latch + 1;
+
+    return irq_counter;
+  }
+}
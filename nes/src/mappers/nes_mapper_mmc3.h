@@ -0,0 +1,28 @@
+#include "nes.h"
+#include "nes_mapper.h"
+
+namespace NES_Emulator {
+  // Mapper 4: 8KB PRG and 1KB/2KB CHR banks, with a scanline counter IRQ
+  class NES_Mapper_MMC3 : public NES_Mapper {
+  private:
+    // Bank registers R0-R7, and which one $8001 writes
+    BYTE bank_select;
+    BYTE registers[8];
+
+    // Scanline counter
+    BYTE irq_latch;
+    BYTE irq_counter;
+    bool irq_reload;
+    bool irq_enabled;
+
+    void update_banks();
+
+  public:
+    NES_Mapper_MMC3(uint32_t, uint32_t, mirror_mode);
+
+    void cpu_write(address_t, BYTE) override;
+    void serialize(NES_State&) override;
+    void scanline() override;
+    unsigned int get_irq_scanlines() override;
+  };
+}
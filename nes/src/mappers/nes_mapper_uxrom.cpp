@@ -0,0 +1,13 @@
+#include "nes_mapper_uxrom.h"
+
+namespace NES_Emulator {
+  NES_Mapper_UxROM::NES_Mapper_UxROM(uint32_t prg_size, uint32_t chr_size, mirror_mode mirror) : NES_Mapper(prg_size, chr_size, mirror) {
+    set_prg_16k(0, 0);
+    set_prg_16k(1, number_prg_banks - 1);
+  }
+
+  void NES_Mapper_UxROM::cpu_write(address_t, BYTE val) {
+    // Any write selects the bank at $8000, bus conflicts are not emulated.
+    set_prg_16k(0, val);
+  }
+}
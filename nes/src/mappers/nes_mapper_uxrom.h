@@ -0,0 +1,12 @@
+#include "nes.h"
+#include "nes_mapper.h"
+
+namespace NES_Emulator {
+  // Mapper 2: 16KB switchable PRG bank at $8000, last bank fixed at $C000, CHR RAM
+  class NES_Mapper_UxROM : public NES_Mapper {
+  public:
+    NES_Mapper_UxROM(uint32_t, uint32_t, mirror_mode);
+
+    void cpu_write(address_t, BYTE) override;
+  };
+}
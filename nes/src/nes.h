@@ -1,15 +1,25 @@
 #include <cstdint>
+#include <cstdlib>
 #include <string>
 #include <fstream>
 #include <vector>
+#include <deque>
+#include <cstring>
+#include <algorithm>
 #include <unordered_map>
 #include <unordered_set>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
 
 namespace NES_Emulator {
   typedef unsigned char BYTE;
   typedef unsigned short int WORD;
   typedef unsigned char page_t;
   typedef unsigned char cycle_t;
+  typedef uint64_t master_cycle_t;
   typedef unsigned char opcode_t;
   typedef unsigned short int operand_t;
   typedef unsigned short int address_t;
@@ -18,6 +28,64 @@ namespace NES_Emulator {
   enum mirror_mode {
     VERTICAL,
     HORIZONTAL,
-    FOUR_SCREEN
+    FOUR_SCREEN,
+    ONE_SCREEN_LO,
+    ONE_SCREEN_HI
+  };
+
+  // TV system a ROM is made for
+  enum nes_region {
+    nes_region_ntsc,  // NTSC NES and Famicom
+    nes_region_pal,   // PAL NES
+    nes_region_multi, // Runs on either
+    nes_region_dendy, // Dendy and other PAL famiclones
+  };
+
+  enum nes_addr_mode {
+      nes_addr_mode_imp, 
+      nes_addr_mode_acc,        
+      nes_addr_mode_imm,        
+      nes_addr_mode_ind_jmp,    
+      nes_addr_mode_rel,        
+      nes_addr_mode_abs,                     
+      nes_addr_mode_abs_jmp,                   
+      nes_addr_mode_zp,
+      nes_addr_mode_zp_x,
+      nes_addr_mode_zp_y,   
+      nes_addr_mode_abs_x,      
+      nes_addr_mode_abs_y,      
+      nes_addr_mode_zp_ind_x,      
+      nes_addr_mode_zp_ind_y,      
+  };
+
+  // Execution engines
+  enum nes_cpu_core {
+    nes_cpu_core_table,    // Table dispatch through run_instruction
+    nes_cpu_core_threaded, // Direct threaded dispatch (GCC/Clang labels as values)
+    nes_cpu_core_block,    // Predecoded PRG ROM blocks from NES_CPU_Block_Cache
+    nes_cpu_core_jit,      // Hot blocks compiled to x86-64 by NES_CPU_JIT
+  };
+
+  // PPU synchronization
+  enum nes_ppu_sync {
+    nes_ppu_sync_catch_up, // PPU runs only when the CPU touches it or an event is due
+    nes_ppu_sync_lockstep, // PPU is caught up after every CPU instruction
+  };
+
+  // Pixel formats NES_Frame converts to
+  enum nes_pixel_format {
+    nes_pixel_format_rgba8888, // Bytes R, G, B, A
+    nes_pixel_format_bgra8888, // Bytes B, G, R, A (0xAARRGGBB on little endian hosts)
+    nes_pixel_format_rgb565,   // 16-bit words, red in the top 5 bits
+    nes_pixel_format_gray8,    // One luma byte
+  };
+
+  // Scheduled system events
+  enum nes_event {
+    nes_event_vblank,          // Scanline 241, NMI when enabled
+    nes_event_vblank_end,      // Pre-render scanline, vblank and sprite flags cleared
+    nes_event_sprite_zero_hit, // Sprite 0 hit flag set
+    nes_event_mapper_irq,      // Mapper scanline counter IRQ
+    nes_event_count
   };
 }
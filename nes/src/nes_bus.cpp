@@ -1,63 +1,237 @@
 #include "nes_bus.h"
+#include "nes_system.h"
 
 namespace NES_Emulator {
   NES_Bus::NES_Bus() {
     ppu = new NES_PPU();
+    cartridge = nullptr;
+    mapped_generation = 0;
+    system = nullptr;
+
+    // CPU RAM, mirrored every 2KB up to $1FFF.
+    for (int page = 0x00; page < 0x20; page++) {
+      BYTE* ram = cpu_ram + ((page << 8) & 0x07FF);
+      map_page(page, ram, ram, nullptr, nullptr);
+    }
+
+    // PPU registers, mirrored every 8 bytes up to $3FFF.
+    for (int page = 0x20; page < 0x40; page++)
+      map_page(page, nullptr, nullptr, &NES_Bus::read_ppu_register, &NES_Bus::write_ppu_register);
+
+    // APU and IO registers.
+    map_page(0x40, nullptr, nullptr, &NES_Bus::read_io, &NES_Bus::write_io);
+
+    // Expansion ROM is not emulated, PRG RAM is mapped with the cartridge.
+    for (int page = 0x41; page < 0x80; page++)
+      map_page(page, nullptr, nullptr, &NES_Bus::read_open_bus, &NES_Bus::write_open_bus);
+
+    // PRG ROM is mapped when a cartridge is inserted.
+    for (int page = 0x80; page < 0x100; page++)
+      map_page(page, nullptr, nullptr, &NES_Bus::read_open_bus, &NES_Bus::write_open_bus);
+  }
+
+  NES_Bus::~NES_Bus() {
+    delete ppu;
   }
 
   BYTE NES_Bus::cpu_read(address_t address) {
-    // CPU RAM addressing (with mirroring).
-    if (address >= 0x0000 && address <= 0x1FFF)
-      return cpu_ram[address & 0x07FF];
-    // PPU Status register.
-    else if (address == 0x2002)
-      return ppu->read_status();
-    // PPU OAM Data.
-    else if (address == 0x2004)
-      return ppu->read_oam_data();
-    // PPU Register addressing.
-    else if (address == 0x2007)
-      return ppu->read();
-    // CPU read with mirrored down address.
-    else if (address >= 0x2008 && address <= 0x7FFF)
-      return cpu_read(address & 0x2007);
-    // CPU read from cartridge ROM.
-    else if (address >= 0x8000 && address <= 0xFFFF)
-      return cartridge->read_prg_memory(address - 0x8000);
-    return 0x00;
+    const memory_page &page = pages[address >> 8];
+
+    if (page.read)
+      return page.read[address & 0x00FF];
+
+    return (this->*page.read_register)(address);
   }
 
   void NES_Bus::cpu_write(address_t address, BYTE val) {
-    // CPU RAM addressing (with mirroring).
-    if (address >= 0x0000 && address <= 0x1FFF)
-      cpu_ram[address & 0x07FF] = val;
-    // PPU Control register
-    else if (address == 0x2000)
-      ppu->write_to_control(val);
-    // PPU Mask register
-    else if (address == 0x2001)
-      ppu->write_to_mask(val);
-    // PPU OAM address
-    else if (address == 0x2003)
-      ppu->write_to_oam_addr(val);
-    // PPU OAM Data
-    else if (address == 0x2004)
-      ppu->write_to_oam_data(val);
-    // PPU scroll register.
-    else if (address == 0x2005)
-      ppu->write_to_scroll(val);
-    // PPU address register.
-    else if (address == 0x2006)
-      ppu->write_to_ppu_addr(val);
-    // PPU data register.
-    else if (address = 0x2007)
-      ppu->write_to_ppu_data(val);
-    // CPU write with mirrored down address.
-    else if (address >= 0x2008 && address <= 0x7FFF)
-      cpu_write(address & 0x2007, val);
+    const memory_page &page = pages[address >> 8];
+
+    if (page.write)
+      page.write[address & 0x00FF] = val;
+    else
+      (this->*page.write_register)(address, val);
+  }
+
+  void NES_Bus::map_page(uint8_t page, const BYTE* read, BYTE* write, read_handler read_register, write_handler write_register) {
+    pages[page].read = read;
+    pages[page].write = write;
+    pages[page].read_register = read_register;
+    pages[page].write_register = write_register;
+  }
+
+  void NES_Bus::map_cartridge() {
+    // PRG ROM is read straight from the cartridge, writes go to the mapper.
+    for (int page = 0x80; page < 0x100; page++)
+      map_page(page, cartridge->get_prg_page(page << 8), nullptr, &NES_Bus::read_cartridge, &NES_Bus::write_cartridge);
+
+    mapped_generation = cartridge->get_bank_generation();
+  }
+
+  void NES_Bus::sync_ppu() {
+    // Without a system the PPU has no clock to catch up to.
+    if (system)
+      system->sync_ppu();
+  }
+
+  BYTE NES_Bus::read_ppu_register(address_t address) {
+    sync_ppu();
+
+    switch (address & 0x0007) {
+      // PPU Status register.
+      case 0x0002:
+        return ppu->read_status();
+      // PPU OAM Data.
+      case 0x0004:
+        return ppu->read_oam_data();
+      // PPU data register.
+      case 0x0007:
+        return ppu->read();
+    }
+
+    return 0x00;
+  }
+
+  void NES_Bus::write_ppu_register(address_t address, BYTE val) {
+    sync_ppu();
+
+    switch (address & 0x0007) {
+      // PPU Control register
+      case 0x0000:
+        ppu->write_to_control(val);
+        break;
+      // PPU Mask register
+      case 0x0001:
+        ppu->write_to_mask(val);
+
+        // Turning rendering on starts the mapper's scanline clock.
+        if (system)
+          system->schedule_mapper_irq();
+        break;
+      // PPU OAM address
+      case 0x0003:
+        ppu->write_to_oam_addr(val);
+        break;
+      // PPU OAM Data
+      case 0x0004:
+        ppu->write_to_oam_data(val);
+        break;
+      // PPU scroll register.
+      case 0x0005:
+        ppu->write_to_scroll(val);
+        break;
+      // PPU address register.
+      case 0x0006:
+        ppu->write_to_ppu_addr(val);
+        break;
+      // PPU data register.
+      case 0x0007:
+        ppu->write_to_ppu_data(val);
+        break;
+    }
+
+    // The write may have moved the sprite 0 hit.
+    if (system) {
+      system->schedule_sprite_zero_hit();
+      system->trace_ppu_write(address, val);
+    }
+  }
+
+  BYTE NES_Bus::read_cartridge(address_t address) {
+    return cartridge->read_prg_memory(address - 0x8000);
+  }
+
+  void NES_Bus::write_cartridge(address_t address, BYTE val) {
+    // Mapper registers can change what the PPU sees.
+    sync_ppu();
+    cartridge->write_prg_memory(address - 0x8000, val);
+
+    // Remap PRG ROM after a bank switch.
+    if (cartridge->get_bank_generation() != mapped_generation)
+      map_cartridge();
+
+    ppu->update_banks();
+
+    // The write may have moved the sprite 0 hit and the mapper IRQ.
+    if (system) {
+      system->schedule_sprite_zero_hit();
+      system->schedule_mapper_irq();
+    }
+  }
+
+  void NES_Bus::write_prg_ram(address_t address, BYTE val) {
+    cartridge->write_prg_ram(address - 0x6000, val);
+  }
+
+  BYTE NES_Bus::read_io(address_t) {
+    // APU and controllers are not emulated yet.
+    return 0x00;
+  }
+
+  void NES_Bus::write_io(address_t address, BYTE val) {
+    // OAM DMA copies a whole CPU page into OAM, halting the CPU for 513 cycles.
+    if (address == 0x4014) {
+      address_t page = val << 8;
+      sync_ppu();
+
+      for (int i = 0; i < 256; i++)
+        ppu->write_to_oam_data(cpu_read(page | i));
+
+      if (system) {
+        system->schedule_sprite_zero_hit();
+        system->stall_cpu(513);
+      }
+    }
+  }
+
+  BYTE NES_Bus::read_open_bus(address_t) {
+    return 0x00;
+  }
+
+  void NES_Bus::write_open_bus(address_t, BYTE) {
   }
 
   void NES_Bus::insert_cartridge(NES_Cartridge* cartridge) {
     this->cartridge = cartridge;
+
+    /**
+     * PRG RAM is plain memory, read and written without the cartridge.
+     * Battery RAM the save file could not map is written through it, to
+     * mark the pages its writer has to write back.
+     */
+    bool tracked = cartridge->is_prg_ram_tracked();
+
+    for (int page = 0x60; page < 0x80; page++) {
+      BYTE* ram = cartridge->get_prg_ram() + ((page - 0x60) << 8);
+      map_page(page, ram, tracked ? nullptr : ram, nullptr, &NES_Bus::write_prg_ram);
+    }
+
+    map_cartridge();
+  }
+
+  NES_PPU* NES_Bus::get_ppu() {
+    return ppu;
+  }
+
+  void NES_Bus::attach_system(NES_System* system) {
+    this->system = system;
+  }
+
+  BYTE* NES_Bus::get_cpu_ram() {
+    return cpu_ram;
+  }
+
+  void NES_Bus::serialize(NES_State &state) {
+    state.bytes(cpu_ram, sizeof(cpu_ram));
+
+    if (state.is_loading() && cartridge)
+      map_cartridge();
+  }
+
+  unsigned int NES_Bus::get_prg_bank(address_t address) {
+    return cartridge->get_prg_bank(address);
+  }
+
+  const unsigned int &NES_Bus::get_bank_generation() {
+    return cartridge->get_bank_generation();
   }
 }
@@ -3,10 +3,32 @@
 #include "nes_ppu.h"
 
 namespace NES_Emulator {
+  class NES_System;
+
   class NES_Bus {
   private:
-    // CPU Memory
-    BYTE cpu_ram[0xFFFF];
+    // Register handlers
+    typedef BYTE (NES_Bus::*read_handler)(address_t);
+    typedef void (NES_Bus::*write_handler)(address_t, BYTE);
+
+    // 256 byte page of the CPU address space. Pages backed by host memory are
+    // accessed through the pointers, everything else through the handlers.
+    struct memory_page {
+      const BYTE* read;
+      BYTE* write;
+      read_handler read_register;
+      write_handler write_register;
+    };
+
+    // CPU Memory, 2KB mirrored up to $1FFF
+    BYTE cpu_ram[0x0800];
+
+    // CPU memory map
+    memory_page pages[0x100];
+    unsigned int mapped_generation;
+
+    // System, for PPU catch-up and DMA timing
+    NES_System* system;
 
     // PPU
     NES_PPU* ppu;
@@ -14,8 +36,29 @@ namespace NES_Emulator {
     // Cartridge
     NES_Cartridge* cartridge;
 
+    // Memory map
+    void map_page(uint8_t, const BYTE*, BYTE*, read_handler, write_handler);
+    void map_cartridge();
+
+    // Register handlers
+    void sync_ppu();
+    BYTE read_ppu_register(address_t);
+    void write_ppu_register(address_t, BYTE);
+    BYTE read_cartridge(address_t);
+    void write_cartridge(address_t, BYTE);
+    void write_prg_ram(address_t, BYTE);
+    BYTE read_io(address_t);
+    void write_io(address_t, BYTE);
+    BYTE read_open_bus(address_t);
+    void write_open_bus(address_t, BYTE);
+
   public:
     NES_Bus();
+    ~NES_Bus();
+
+    // Owns the PPU
+    NES_Bus(const NES_Bus&) = delete;
+    NES_Bus &operator=(const NES_Bus&) = delete;
 
     // CPU Read and Write
     BYTE cpu_read(address_t);
@@ -23,5 +66,17 @@ namespace NES_Emulator {
 
     // System interface
     void insert_cartridge(NES_Cartridge*);
+    NES_PPU* get_ppu();
+    void attach_system(NES_System*);
+
+    // Host memory
+    BYTE* get_cpu_ram();
+
+    // Save states, after the cartridge so PRG ROM is mapped from its restored banks
+    void serialize(NES_State&);
+
+    // Cartridge banks
+    unsigned int get_prg_bank(address_t);
+    const unsigned int &get_bank_generation();
   };
 }
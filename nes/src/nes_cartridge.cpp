@@ -1,89 +1,345 @@
 #include "nes_cartridge.h"
 
 namespace NES_Emulator {
-  NES_Cartridge::NES_Cartridge(const std::string &file_name) {
-    // iNES Format Header
+  // NES 2.0 ROM size: 12-bit count of units, or exponent-multiplier when the high nibble is $F
+  static uint64_t nes2_rom_size(uint8_t lsb, uint8_t msb, uint64_t unit) {
+    if (msb == 0x0F)
+      return (lsb >> 2) < 48 ? (1ULL << (lsb >> 2)) * ((lsb & 0x03) * 2 + 1) : UINT64_MAX;
+
+    return ((msb << 8) | lsb) * unit;
+  }
+
+  // NES 2.0 RAM size: 64 << shift bytes, 0 for none
+  static uint32_t nes2_ram_size(uint8_t shift) {
+    return shift ? 64 << shift : 0;
+  }
+
+  NES_Cartridge::NES_Cartridge(const std::string &file_name, const std::string &save_file) {
+    // iNES Format Header, bytes 8-15 as NES 2.0 lays them out
     struct sHeader {
       char name[4];
       uint8_t prg_rom_chunks;
       uint8_t chr_rom_chunks;
-      uint8_t mapper1;
-      uint8_t mapper2;
-      uint8_t prg_ram_size;
-      uint8_t tv_system1;
-      uint8_t tv_system2;
-      char unused[5];
+      uint8_t mapper1;       // Mapper low nibble, four-screen, trainer, battery, mirroring
+      uint8_t mapper2;       // Mapper middle nibble, header format
+      uint8_t mapper3;       // Mapper high nibble and submapper (iNES: PRG RAM size)
+      uint8_t rom_size_msb;  // PRG and CHR ROM size high nibbles (iNES: TV system)
+      uint8_t prg_ram_shift; // PRG RAM and NVRAM sizes
+      uint8_t chr_ram_shift; // CHR RAM and NVRAM sizes
+      uint8_t timing;        // Region
+      uint8_t unused[3];
     } header;
 
-    // Read file in ifstream
-    std::ifstream ifs;
-	  ifs.open(file_name, std::ifstream::binary);
+    info = rom_info();
+    info.mirror = HORIZONTAL;
+    info.region = nes_region_ntsc;
+    info.prg_ram_size = 8192;
+    info.chr_ram_size = 8192;
+
+    chr_ram = false;
+    prg_ram = nullptr;
+    prg_ram_size = 0;
+    save = nullptr;
+    prg_memory = nullptr;
+    prg_size = 0;
+    chr_memory = nullptr;
+    chr_size = 0;
+    tiles = nullptr;
 
-    // Make sure file opened properly
-    if (!ifs.is_open())
+    // Map the file through the ROM pool, shared with every cartridge of the same game
+    image = NES_ROM_Pool::acquire(file_name);
+
+    // Make sure file opened properly, an empty cart still has PRG and CHR RAM
+    if (!image || image->size < sizeof(sHeader)) {
+      attach_ram(save_file);
+      mapper = new NES_Mapper(0, chr_size, info.mirror);
       return;
+    }
     
     // Read file header
-		ifs.read((char*)&header, sizeof(sHeader));
+    memcpy(&header, image->data, sizeof(sHeader));
+    size_t offset = sizeof(sHeader);
 
-		// If a "trainer" exists we just need to read past
+		// If a "trainer" exists we just need to skip
 		// it before we get to the good stuff
 		if (header.mapper1 & 0x04)
-			ifs.seekg(512, std::ios_base::cur);
-
-		// Determine Mapper ID
-		mapper_id = ((header.mapper2 >> 4) << 4) | (header.mapper1 >> 4);
+			offset += 512;
 
-		// "Discover" File Format
+		// "Discover" File Format: 0 is archaic iNES, 1 iNES, 2 NES 2.0
 		uint8_t file_type = 1;
 
-		if (file_type == 0) {
+    if ((header.mapper2 & 0x0C) == 0x08)
+      file_type = 2;
+    else if ((header.mapper2 & 0x0C) != 0 || header.timing || header.unused[0] || header.unused[1] || header.unused[2])
+      file_type = 0;
+
+    // Byte 6 means the same in every format.
+    info.mapper = header.mapper1 >> 4;
+    info.battery = header.mapper1 & 0x02;
+
+    if (header.mapper1 & 0x08)
+      info.mirror = FOUR_SCREEN;
+    else
+      info.mirror = (header.mapper1 & 0x01) ? VERTICAL : HORIZONTAL;
 
+    uint64_t prg_rom_size = header.prg_rom_chunks * 16384;
+    uint64_t chr_rom_size = header.chr_rom_chunks * 8192;
+
+		if (file_type == 0) {
+      // Old tools signed their name over bytes 7-15 ("DiskDude!"), none of it is header.
 		}
 
 		if (file_type == 1) {
-			number_prg_banks = header.prg_rom_chunks;
-			prg_memory.resize(number_prg_banks * 16384);
-			ifs.read((char*)prg_memory.data(), prg_memory.size());
+      info.mapper |= header.mapper2 & 0xF0;
+      info.region = header.rom_size_msb & 0x01 ? nes_region_pal : nes_region_ntsc;
 
-			number_chr_banks = header.chr_rom_chunks;
-			chr_memory.resize(number_chr_banks * 8192);
-			ifs.read((char*)chr_memory.data(), chr_memory.size());
+      if (header.mapper3)
+        info.prg_ram_size = header.mapper3 * 8192;
 		}
 
 		if (file_type == 2) {
+      info.mapper |= (header.mapper2 & 0xF0) | (header.mapper3 & 0x0F) << 8;
+      info.submapper = header.mapper3 >> 4;
+      info.region = (nes_region)(header.timing & 0x03);
+
+      prg_rom_size = nes2_rom_size(header.prg_rom_chunks, header.rom_size_msb & 0x0F, 16384);
+      chr_rom_size = nes2_rom_size(header.chr_rom_chunks, header.rom_size_msb >> 4, 8192);
 
+      info.prg_ram_size = nes2_ram_size(header.prg_ram_shift & 0x0F);
+      info.prg_nvram_size = nes2_ram_size(header.prg_ram_shift >> 4);
+      info.chr_ram_size = nes2_ram_size(header.chr_ram_shift & 0x0F);
+      info.chr_nvram_size = nes2_ram_size(header.chr_ram_shift >> 4);
 		}
 
+    // Before NES 2.0 the battery is all the header says about saved RAM.
+    if (file_type != 2) {
+      if (info.battery)
+        std::swap(info.prg_ram_size, info.prg_nvram_size);
+
+      if (chr_rom_size)
+        info.chr_ram_size = 0;
+    }
+
+    // A known dump overrides whatever the header says.
+    NES_ROM_Database::entry known;
+
+    if (NES_ROM_Database::is_open() && NES_ROM_Database::find(NES_ROM_Pool::get_crc32(image, offset), known)) {
+      info.mapper = known.mapper;
+      info.submapper = known.submapper;
+      info.mirror = (mirror_mode)known.mirror;
+      info.battery = known.flags & NES_ROM_Database::FLAG_BATTERY;
+      info.region = (nes_region)known.region;
+      info.prg_ram_size = nes2_ram_size(known.prg_ram_shift);
+      info.prg_nvram_size = nes2_ram_size(known.prg_nvram_shift);
+      info.chr_ram_size = nes2_ram_size(known.chr_ram_shift);
+      info.chr_nvram_size = nes2_ram_size(known.chr_nvram_shift);
+      prg_rom_size = known.prg_rom_size;
+      chr_rom_size = known.chr_rom_size;
+    }
+
+    // ROM is read in place, so a file cut short loads as an empty cart.
+    if (prg_rom_size > image->size || chr_rom_size > image->size || offset + prg_rom_size + chr_rom_size > image->size) {
+      prg_rom_size = 0;
+      chr_rom_size = 0;
+    }
+
+    info.prg_rom_size = prg_rom_size;
+    info.chr_rom_size = chr_rom_size;
+
+    prg_memory = image->data + offset;
+    prg_size = prg_rom_size;
+
+    if (chr_rom_size) {
+      chr_memory = prg_memory + prg_size;
+      chr_size = chr_rom_size;
+      tiles = NES_ROM_Pool::get_chr_tiles(image, chr_memory, chr_size);
+    }
+
+    // Saves go beside the ROM unless told otherwise.
+    if (save_file.empty() && info.battery) {
+      size_t extension = file_name.find_last_of('.');
+
+      if (extension == std::string::npos || file_name.find_first_of("/\\", extension) != std::string::npos)
+        extension = file_name.size();
+
+      attach_ram(file_name.substr(0, extension) + ".sav");
+    }
+    else {
+      attach_ram(save_file);
+    }
+
 		// Load appropriate mapper
-		switch (mapper_id) {
-		case 0: 
-      mapper = new NES_Mapper(number_prg_banks, number_chr_banks); 
+		switch (info.mapper) {
+		case 1:
+      mapper = new NES_Mapper_MMC1(prg_size, chr_size, info.mirror);
+      break;
+    case 2:
+      mapper = new NES_Mapper_UxROM(prg_size, chr_size, info.mirror);
+      break;
+    case 3:
+      mapper = new NES_Mapper_CNROM(prg_size, chr_size, info.mirror);
+      break;
+    case 4:
+      mapper = new NES_Mapper_MMC3(prg_size, chr_size, info.mirror);
+      break;
+    // NROM, and unsupported mappers run as NROM.
+    default:
+      mapper = new NES_Mapper(prg_size, chr_size, info.mirror);
       break;
 		}
+  }
+
+  NES_Cartridge::~NES_Cartridge() {
+    delete mapper;
+
+    // Battery RAM is written back by the save file's writer, off this thread.
+    delete save;
 
-		ifs.close();
+    if (image)
+      NES_ROM_Pool::release(image);
   }
 
-  BYTE NES_Cartridge::read_prg_memory(address_t address) {
-    if (prg_memory.size() == 0x4000) {
-      // Mirror for 16KB addresses
-      return prg_memory[address & 0x3FFF];
+  void NES_Cartridge::attach_ram(const std::string &save_file) {
+    /**
+     * RAM is the one part of the cartridge every instance has its own copy
+     * of. $6000-$7FFF is always backed, there is no PRG RAM banking yet.
+     * With a battery all of it is saved.
+     */
+    prg_ram_size = std::max<size_t>(info.prg_ram_size + info.prg_nvram_size, 8192);
+
+    if (info.battery && !save_file.empty()) {
+      save = new NES_Save_File(save_file, prg_ram_size);
+      prg_ram = save->get_memory();
+    }
+    else {
+      prg_ram_memory.resize(prg_ram_size);
+      prg_ram = prg_ram_memory.data();
     }
 
-    return prg_memory[address];
+    if (chr_size)
+      return;
+
+    chr_ram_memory.resize(std::max<size_t>(info.chr_ram_size + info.chr_nvram_size, 8192));
+    chr_ram_tiles.attach(chr_ram_memory.data(), chr_ram_memory.size());
+    chr_memory = chr_ram_memory.data();
+    chr_size = chr_ram_memory.size();
+    chr_ram = true;
+    tiles = &chr_ram_tiles;
+  }
+
+  BYTE NES_Cartridge::read_prg_memory(address_t address) {
+    if (prg_size == 0)
+      return 0x00;
+
+    return prg_memory[mapper->map_prg(0x8000 + address)];
   }
 
   BYTE NES_Cartridge::read_chr_memory(address_t address) {
-    if (chr_memory.size() == 0x4000) {
-      // Mirror for 16KB addresses
-      return chr_memory[address & 0x3FFF];
+    return chr_memory[mapper->map_chr(address)];
+  }
+
+  const BYTE* NES_Cartridge::get_tile(uint32_t offset, bool flip) {
+    return tiles->get(offset, flip);
+  }
+
+  void NES_Cartridge::write_prg_memory(address_t address, BYTE val) {
+    mapper->cpu_write(0x8000 + address, val);
+  }
+
+  void NES_Cartridge::write_chr_memory(address_t address, BYTE val) {
+    if (chr_ram) {
+      uint32_t offset = mapper->map_chr(address);
+      chr_ram_memory[offset] = val;
+      tiles->invalidate(offset, 1);
     }
+  }
+
+  const BYTE* NES_Cartridge::get_prg_page(address_t address) {
+    if (prg_size == 0)
+      return nullptr;
+
+    return prg_memory + mapper->map_prg(address);
+  }
+
+  BYTE* NES_Cartridge::get_prg_ram() {
+    return prg_ram;
+  }
+
+  bool NES_Cartridge::has_battery() {
+    return save != nullptr;
+  }
+
+  bool NES_Cartridge::is_prg_ram_tracked() {
+    return save && !save->is_mapped();
+  }
+
+  void NES_Cartridge::write_prg_ram(address_t offset, BYTE val) {
+    prg_ram[offset] = val;
+    save->mark_dirty(offset, 1);
+  }
+
+  uint32_t NES_Cartridge::get_chr_offset(address_t address) {
+    return mapper->map_chr(address);
+  }
+
+  const BYTE* NES_Cartridge::get_chr_page(address_t address) {
+    return chr_memory + mapper->map_chr(address);
+  }
 
-    return chr_memory[address];
+  bool NES_Cartridge::has_chr_ram() {
+    return chr_ram;
+  }
+
+  const NES_Cartridge::rom_info &NES_Cartridge::get_info() {
+    return info;
   }
 
   mirror_mode NES_Cartridge::get_mirror_mode() {
-    return mirror;
+    return mapper->get_mirror_mode();
+  }
+
+  void NES_Cartridge::scanline() {
+    mapper->scanline();
+  }
+
+  unsigned int NES_Cartridge::get_irq_scanlines() {
+    return mapper->get_irq_scanlines();
+  }
+
+  bool NES_Cartridge::get_irq() {
+    return mapper->get_irq();
+  }
+
+  unsigned int NES_Cartridge::get_prg_bank(address_t address) {
+    return mapper->get_prg_bank(address);
+  }
+
+  const unsigned int &NES_Cartridge::get_bank_generation() {
+    return mapper->get_bank_generation();
+  }
+
+  const unsigned int &NES_Cartridge::get_chr_generation() {
+    return mapper->get_chr_generation();
+  }
+
+  uint64_t NES_Cartridge::get_rom_hash() {
+    return image ? image->hash : 0;
+  }
+
+  void NES_Cartridge::serialize(NES_State &state) {
+    // Battery RAM loads straight into the save file, as if the game had written it.
+    state.bytes(prg_ram, prg_ram_size);
+
+    if (state.is_loading() && save)
+      save->mark_dirty(0, prg_ram_size);
+
+    if (chr_ram) {
+      state.bytes(chr_ram_memory.data(), chr_ram_memory.size());
+
+      if (state.is_loading())
+        tiles->invalidate(0, chr_ram_memory.size());
+    }
+
+    mapper->serialize(state);
   }
 }
@@ -1,32 +1,115 @@
 #include "nes.h"
 #include "nes_mapper.h"
+#include "nes_mapper_mmc1.h"
+#include "nes_mapper_uxrom.h"
+#include "nes_mapper_cnrom.h"
+#include "nes_mapper_mmc3.h"
+#include "nes_tile_cache.h"
+#include "nes_rom_pool.h"
+#include "nes_rom_database.h"
+#include "nes_save_file.h"
 
 namespace NES_Emulator {
   class NES_Cartridge {
+  public:
+    // Board details from the header, corrected by the ROM database
+    struct rom_info {
+      uint16_t mapper;
+      uint8_t submapper;
+      mirror_mode mirror;
+      bool battery;
+      nes_region region;
+      uint32_t prg_rom_size;
+      uint32_t chr_rom_size;
+      uint32_t prg_ram_size;   // Volatile
+      uint32_t prg_nvram_size; // Battery backed
+      uint32_t chr_ram_size;
+      uint32_t chr_nvram_size;
+    };
+
   private:
-    // Memory
-    std::vector<BYTE> prg_memory;
-    std::vector<BYTE> chr_memory;
+    // ROM image, shared read-only with every cartridge of the same game
+    NES_ROM_Pool::image* image;
+
+    // PRG and CHR memory, within the image or chr_ram_memory
+    const BYTE* prg_memory;
+    const BYTE* chr_memory;
+    size_t prg_size;
+    size_t chr_size;
+
+    // PRG RAM at $6000-$7FFF, in the save file when the cart has a battery
+    BYTE* prg_ram;
+    size_t prg_ram_size;
+    std::vector<BYTE> prg_ram_memory;
+    NES_Save_File* save;
+
+    // Carts without CHR ROM have CHR RAM instead, 8KB unless the header says otherwise
+    bool chr_ram;
+    std::vector<BYTE> chr_ram_memory;
+    NES_Tile_Cache chr_ram_tiles;
+
+    // CHR decoded into pixels, pooled with the image for CHR ROM
+    NES_Tile_Cache* tiles;
 
     // Mapper metadata
-    uint8_t mapper_id        = 0;
-    uint8_t number_prg_banks = 0;
-    uint8_t number_chr_banks = 0;
+    rom_info info;
 
     // Mapper
     NES_Mapper* mapper;
 
-    // Mirroring
-    mirror_mode mirror;
+    void attach_ram(const std::string&);
 
   public:
-    NES_Cartridge(const std::string&);
+    // Battery RAM is kept in the save file, the ROM's name with a .sav extension when none is given.
+    // Cartridges running at the same time need save files of their own. The save is written in
+    // the background after the cartridge is destroyed, and at the latest when the process exits.
+    NES_Cartridge(const std::string&, const std::string& = std::string());
+    ~NES_Cartridge();
 
     // Read ROM
     BYTE read_prg_memory(address_t);
     BYTE read_chr_memory(address_t);
 
-    // Mirror mode
+    // Write to the mapper or CHR RAM
+    void write_prg_memory(address_t, BYTE);
+    void write_chr_memory(address_t, BYTE);
+
+    // Decoded pixels of the tile at a CHR offset
+    const BYTE* get_tile(uint32_t, bool);
+
+    // Host memory behind a 256 byte page of $8000-$FFFF
+    const BYTE* get_prg_page(address_t);
+
+    // PRG RAM, mapped straight into $6000-$7FFF. Battery RAM that is a copy of its
+    // file is written through write_prg_ram instead, so the save file sees the stores.
+    BYTE* get_prg_ram();
+    bool has_battery();
+    bool is_prg_ram_tracked();
+    void write_prg_ram(address_t, BYTE);
+
+    // CHR memory behind a 1KB page of $0000-$1FFF
+    uint32_t get_chr_offset(address_t);
+    const BYTE* get_chr_page(address_t);
+    bool has_chr_ram();
+
+    // Header details
+    const rom_info &get_info();
+
+    // Mirror mode, mappers can switch it
     mirror_mode get_mirror_mode();
+
+    // Mapper scanline counter, clocked by the PPU
+    void scanline();
+    unsigned int get_irq_scanlines();
+    bool get_irq();
+
+    // Banks
+    unsigned int get_prg_bank(address_t);
+    const unsigned int &get_bank_generation();
+    const unsigned int &get_chr_generation();
+
+    // Save states: PRG RAM, CHR RAM and the mapper, for the ROM with this content hash
+    uint64_t get_rom_hash();
+    void serialize(NES_State&);
   };
 }
@@ -1,17 +1,51 @@
 #include "nes_frame.h"
+#include "nes_palette.h"
 
 namespace NES_Emulator {
+  template<typename T>
+  static void convert_rows(const uint16_t* src, BYTE* dst, size_t pitch, const T* lut) {
+    for (address_t y = 0; y < NES_Frame::HEIGHT; y++) {
+      T* row = (T*)(dst + y * pitch);
+
+      for (address_t x = 0; x < NES_Frame::WIDTH; x++)
+        row[x] = lut[src[x]];
+
+      src += NES_Frame::WIDTH;
+    }
+  }
+
   NES_Frame::NES_Frame() {
-    data = std::vector<uint8_t>((int)WIDTH * HEIGHT * 3, 0);
+    data = std::vector<uint16_t>((int)WIDTH * HEIGHT, 0);
+  }
+
+  uint16_t* NES_Frame::get_line(address_t y) {
+    return data.data() + y * WIDTH;
+  }
+
+  const uint16_t* NES_Frame::get_pixels() {
+    return data.data();
   }
 
-  void NES_Frame::set_pixel(address_t x, address_t y, uint8_t r, uint8_t g, uint8_t b) {
-    uint8_t base = y * 3 * WIDTH + x * 3;
+  void NES_Frame::convert(nes_pixel_format format, void* buffer, size_t pitch) {
+    /**
+     * One table load per pixel. The tables hold every emphasis combination,
+     * so nothing about the PPUMASK state at the time has to be passed along.
+     */
+    BYTE* dst = (BYTE*)buffer;
 
-    if (base + 2 < data.size()) {
-      data[base]     = r;
-      data[base + 1] = g;
-      data[base + 2] = b;
+    switch (format) {
+      case nes_pixel_format_rgba8888:
+        convert_rows(data.data(), dst, pitch, NES_Palette::get_rgba8888());
+        break;
+      case nes_pixel_format_bgra8888:
+        convert_rows(data.data(), dst, pitch, NES_Palette::get_bgra8888());
+        break;
+      case nes_pixel_format_rgb565:
+        convert_rows(data.data(), dst, pitch, NES_Palette::get_rgb565());
+        break;
+      case nes_pixel_format_gray8:
+        convert_rows(data.data(), dst, pitch, NES_Palette::get_gray8());
+        break;
     }
   }
 }
\ No newline at end of file
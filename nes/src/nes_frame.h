@@ -2,16 +2,22 @@
 
 namespace NES_Emulator {
   class NES_Frame {
-  private:
-    std::vector<uint8_t> data;
-
+  public:
     static const address_t WIDTH  = 256;
     static const address_t HEIGHT = 240;
 
+  private:
+    // Pixels as emphasis bits << 6 | palette value, row by row
+    std::vector<uint16_t> data;
+
   public:
     NES_Frame();
 
-    // Pixel function
-    void set_pixel(address_t, address_t, uint8_t, uint8_t, uint8_t);
+    // Rows, written by the PPU
+    uint16_t* get_line(address_t);
+    const uint16_t* get_pixels();
+
+    // Convert the whole frame into a caller's buffer, rows pitch bytes apart
+    void convert(nes_pixel_format, void*, size_t);
   };
-}
\ No newline at end of file
+}
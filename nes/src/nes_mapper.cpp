@@ -1,8 +1,153 @@
 #include "nes_mapper.h"
 
 namespace NES_Emulator {
-  NES_Mapper::NES_Mapper(uint8_t number_prg_banks, uint8_t number_chr_banks) {
-    this->number_prg_banks = number_prg_banks;
-    this->number_chr_banks = number_chr_banks;
+  NES_Mapper::NES_Mapper(uint32_t prg_size, uint32_t chr_size, mirror_mode mirror) {
+    this->prg_size = prg_size;
+    this->chr_size = chr_size;
+    this->mirror = mirror;
+
+    number_prg_banks = prg_size / 0x4000;
+    number_chr_banks = chr_size / 0x2000;
+
+    bank_generation = 0;
+    chr_generation = 0;
+    irq = false;
+
+    // NROM layout: the first 32KB of PRG ROM, 16KB carts mirrored, and the first 8KB of CHR.
+    for (unsigned int window = 0; window < 4; window++)
+      prg_banks[window] = prg_size ? (window * 0x2000) % prg_size : 0;
+
+    for (unsigned int window = 0; window < 8; window++)
+      chr_banks[window] = window * 0x0400;
+  }
+
+  NES_Mapper::~NES_Mapper() {
+  }
+
+  void NES_Mapper::cpu_write(address_t, BYTE) {
+    // NROM has no bank registers.
+  }
+
+  void NES_Mapper::scanline() {
+  }
+
+  unsigned int NES_Mapper::get_irq_scanlines() {
+    return 0;
+  }
+
+  bool NES_Mapper::get_irq() {
+    return irq;
+  }
+
+  void NES_Mapper::serialize(NES_State &state) {
+    /**
+     * The bank offsets are stored rather than rebuilt from the registers,
+     * which covers mappers without any. Restoring one that differs counts
+     * as a switch, so the CPU and PPU drop what they built on the old one.
+     */
+    for (unsigned int window = 0; window < 4; window++) {
+      uint32_t offset = prg_banks[window];
+      state.value(offset);
+
+      if (state.is_loading() && prg_size && offset < prg_size && prg_banks[window] != offset) {
+        prg_banks[window] = offset;
+        bank_generation++;
+      }
+    }
+
+    for (unsigned int window = 0; window < 8; window++) {
+      uint32_t offset = chr_banks[window];
+      state.value(offset);
+
+      if (state.is_loading() && chr_size && offset < chr_size && chr_banks[window] != offset) {
+        chr_banks[window] = offset;
+        chr_generation++;
+      }
+    }
+
+    BYTE mode = mirror;
+    state.value(mode);
+
+    if (state.is_loading() && mode <= ONE_SCREEN_HI)
+      set_mirror((mirror_mode)mode);
+
+    state.value(irq);
+  }
+
+  void NES_Mapper::set_prg_8k(unsigned int window, unsigned int bank) {
+    uint32_t offset = prg_size ? (bank * 0x2000) % prg_size : 0;
+
+    // The CPU drops its predecoded blocks on a new generation, so only count real switches.
+    if (prg_banks[window] != offset) {
+      prg_banks[window] = offset;
+      bank_generation++;
+    }
+  }
+
+  void NES_Mapper::set_prg_16k(unsigned int window, unsigned int bank) {
+    set_prg_8k(window * 2, bank * 2);
+    set_prg_8k(window * 2 + 1, bank * 2 + 1);
+  }
+
+  void NES_Mapper::set_prg_32k(unsigned int bank) {
+    set_prg_16k(0, bank * 2);
+    set_prg_16k(1, bank * 2 + 1);
+  }
+
+  void NES_Mapper::set_chr_1k(unsigned int window, unsigned int bank) {
+    uint32_t offset = chr_size ? (bank * 0x0400) % chr_size : 0;
+
+    if (chr_banks[window] != offset) {
+      chr_banks[window] = offset;
+      chr_generation++;
+    }
+  }
+
+  void NES_Mapper::set_chr_2k(unsigned int window, unsigned int bank) {
+    set_chr_1k(window * 2, bank * 2);
+    set_chr_1k(window * 2 + 1, bank * 2 + 1);
+  }
+
+  void NES_Mapper::set_chr_4k(unsigned int window, unsigned int bank) {
+    set_chr_2k(window * 2, bank * 2);
+    set_chr_2k(window * 2 + 1, bank * 2 + 1);
+  }
+
+  void NES_Mapper::set_chr_8k(unsigned int bank) {
+    set_chr_4k(0, bank * 2);
+    set_chr_4k(1, bank * 2 + 1);
+  }
+
+  void NES_Mapper::set_mirror(mirror_mode mirror) {
+    // Four-screen carts have their own VRAM, the mapper cannot fold it.
+    if (this->mirror != FOUR_SCREEN)
+      this->mirror = mirror;
+  }
+
+  uint32_t NES_Mapper::map_prg(address_t address) {
+    // Offset into PRG ROM for a CPU address in $8000-$FFFF.
+    return prg_banks[(address >> 13) & 0x03] + (address & 0x1FFF);
+  }
+
+  uint32_t NES_Mapper::map_chr(address_t address) {
+    // Offset into CHR memory for a PPU address in $0000-$1FFF.
+    return chr_banks[(address >> 10) & 0x07] + (address & 0x03FF);
+  }
+
+  unsigned int NES_Mapper::get_prg_bank(address_t address) {
+    // 8KB bank mapped at a CPU address in $8000-$FFFF.
+    return map_prg(address) >> 13;
+  }
+
+  const unsigned int &NES_Mapper::get_bank_generation() {
+    return bank_generation;
+  }
+
+  const unsigned int &NES_Mapper::get_chr_generation() {
+    return chr_generation;
+  }
+
+  mirror_mode NES_Mapper::get_mirror_mode() {
+    return mirror;
   }
-}
\ No newline at end of file
+}
@@ -1,12 +1,68 @@
 #include "nes.h"
+#include "nes_state.h"
 
 namespace NES_Emulator {
   class NES_Mapper {
   protected:
-    uint8_t number_prg_banks;
-    uint8_t number_chr_banks;
+    // PRG ROM and CHR memory sizes, in bytes
+    uint32_t prg_size;
+    uint32_t chr_size;
+
+    // The same in 16KB and 8KB banks
+    unsigned int number_prg_banks;
+    unsigned int number_chr_banks;
+
+    // Offset of the bank behind each 8KB window of $8000-$FFFF
+    uint32_t prg_banks[4];
+
+    // Offset of the bank behind each 1KB window of $0000-$1FFF
+    uint32_t chr_banks[8];
+
+    // Bumped on every PRG bank switch
+    unsigned int bank_generation;
+
+    // Bumped on every CHR bank switch
+    unsigned int chr_generation;
+
+    // Nametable mirroring, for mappers that switch it
+    mirror_mode mirror;
+
+    // IRQ line, held until the mapper acknowledges it
+    bool irq;
+
+    // Bank switching, bank numbers are in units of the window size and wrap around the memory
+    void set_prg_8k(unsigned int, unsigned int);
+    void set_prg_16k(unsigned int, unsigned int);
+    void set_prg_32k(unsigned int);
+    void set_chr_1k(unsigned int, unsigned int);
+    void set_chr_2k(unsigned int, unsigned int);
+    void set_chr_4k(unsigned int, unsigned int);
+    void set_chr_8k(unsigned int);
+    void set_mirror(mirror_mode);
 
   public:
-    NES_Mapper(uint8_t, uint8_t);
+    NES_Mapper(uint32_t, uint32_t, mirror_mode);
+    virtual ~NES_Mapper();
+
+    // CPU writes to $8000-$FFFF
+    virtual void cpu_write(address_t, BYTE);
+
+    // Clocked by the PPU once per rendered scanline
+    virtual void scanline();
+
+    // Scanline clocks until the IRQ line is raised, 0 when it will not be
+    virtual unsigned int get_irq_scanlines();
+    bool get_irq();
+
+    // Save states, mappers with registers add theirs after the banks
+    virtual void serialize(NES_State&);
+
+    // Banks
+    uint32_t map_prg(address_t);
+    uint32_t map_chr(address_t);
+    unsigned int get_prg_bank(address_t);
+    const unsigned int &get_bank_generation();
+    const unsigned int &get_chr_generation();
+    mirror_mode get_mirror_mode();
   };
 }
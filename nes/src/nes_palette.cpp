@@ -0,0 +1,78 @@
+#include "nes_palette.h"
+
+namespace NES_Emulator {
+  const uint8_t NES_Palette::SYSTEM_PALETTE[COLORS][3] = {
+    {0x80, 0x80, 0x80}, {0x00, 0x3D, 0xA6}, {0x00, 0x12, 0xB0}, {0x44, 0x00, 0x96}, {0xA1, 0x00, 0x5E}, 
+    {0xC7, 0x00, 0x28}, {0xBA, 0x06, 0x00}, {0x8C, 0x17, 0x00}, {0x5C, 0x2F, 0x00}, {0x10, 0x45, 0x00}, 
+    {0x05, 0x4A, 0x00}, {0x00, 0x47, 0x2E}, {0x00, 0x41, 0x66}, {0x00, 0x00, 0x00}, {0x05, 0x05, 0x05}, 
+    {0x05, 0x05, 0x05}, {0xC7, 0xC7, 0xC7}, {0x00, 0x77, 0xFF}, {0x21, 0x55, 0xFF}, {0x82, 0x37, 0xFA}, 
+    {0xEB, 0x2F, 0xB5}, {0xFF, 0x29, 0x50}, {0xFF, 0x22, 0x00}, {0xD6, 0x32, 0x00}, {0xC4, 0x62, 0x00}, 
+    {0x35, 0x80, 0x00}, {0x05, 0x8F, 0x00}, {0x00, 0x8A, 0x55}, {0x00, 0x99, 0xCC}, {0x21, 0x21, 0x21}, 
+    {0x09, 0x09, 0x09}, {0x09, 0x09, 0x09}, {0xFF, 0xFF, 0xFF}, {0x0F, 0xD7, 0xFF}, {0x69, 0xA2, 0xFF}, 
+    {0xD4, 0x80, 0xFF}, {0xFF, 0x45, 0xF3}, {0xFF, 0x61, 0x8B}, {0xFF, 0x88, 0x33}, {0xFF, 0x9C, 0x12}, 
+    {0xFA, 0xBC, 0x20}, {0x9F, 0xE3, 0x0E}, {0x2B, 0xF0, 0x35}, {0x0C, 0xF0, 0xA4}, {0x05, 0xFB, 0xFF}, 
+    {0x5E, 0x5E, 0x5E}, {0x0D, 0x0D, 0x0D}, {0x0D, 0x0D, 0x0D}, {0xFF, 0xFF, 0xFF}, {0xA6, 0xFC, 0xFF}, 
+    {0xB3, 0xEC, 0xFF}, {0xDA, 0xAB, 0xEB}, {0xFF, 0xA8, 0xF9}, {0xFF, 0xAB, 0xB3}, {0xFF, 0xD2, 0xB0}, 
+    {0xFF, 0xEF, 0xA6}, {0xFF, 0xF7, 0x9C}, {0xD7, 0xE8, 0x95}, {0xA6, 0xED, 0xAF}, {0xA2, 0xF2, 0xDA}, 
+    {0x99, 0xFF, 0xFC}, {0xDD, 0xDD, 0xDD}, {0x11, 0x11, 0x11}, {0x11, 0x11, 0x11}
+  };
+
+  uint32_t NES_Palette::rgba8888[EMPHASIS_MODES * COLORS];
+  uint32_t NES_Palette::bgra8888[EMPHASIS_MODES * COLORS];
+  uint16_t NES_Palette::rgb565[EMPHASIS_MODES * COLORS];
+  uint8_t NES_Palette::gray8[EMPHASIS_MODES * COLORS];
+  std::once_flag NES_Palette::built;
+
+  void NES_Palette::build_luts() {
+    /**
+     * Emphasis darkens the channels that are not emphasized. Columns $xE and
+     * $xF are black and stay that way.
+     */
+    for (unsigned int emphasis = 0; emphasis < EMPHASIS_MODES; emphasis++) {
+      for (unsigned int color = 0; color < COLORS; color++) {
+        unsigned int index = emphasis * COLORS + color;
+        unsigned int rgb[3];
+
+        for (int channel = 0; channel < 3; channel++) {
+          rgb[channel] = SYSTEM_PALETTE[color][channel];
+
+          if (emphasis && !(emphasis & (1 << channel)) && (color & 0x0F) < 0x0E)
+            rgb[channel] = rgb[channel] * 3 / 4;
+        }
+
+        // The 32-bit formats are defined by byte order, whatever the host.
+        BYTE rgba[4] = { (BYTE)rgb[0], (BYTE)rgb[1], (BYTE)rgb[2], 0xFF };
+        BYTE bgra[4] = { (BYTE)rgb[2], (BYTE)rgb[1], (BYTE)rgb[0], 0xFF };
+        memcpy(&rgba8888[index], rgba, 4);
+        memcpy(&bgra8888[index], bgra, 4);
+
+        rgb565[index] = ((rgb[0] >> 3) << 11) | ((rgb[1] >> 2) << 5) | (rgb[2] >> 3);
+        gray8[index] = (rgb[0] * 77 + rgb[1] * 150 + rgb[2] * 29) >> 8;
+      }
+    }
+  }
+
+  const uint32_t* NES_Palette::get_rgba8888() {
+    std::call_once(built, build_luts);
+
+    return rgba8888;
+  }
+
+  const uint32_t* NES_Palette::get_bgra8888() {
+    std::call_once(built, build_luts);
+
+    return bgra8888;
+  }
+
+  const uint16_t* NES_Palette::get_rgb565() {
+    std::call_once(built, build_luts);
+
+    return rgb565;
+  }
+
+  const uint8_t* NES_Palette::get_gray8() {
+    std::call_once(built, build_luts);
+
+    return gray8;
+  }
+}
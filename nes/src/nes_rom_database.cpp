@@ -0,0 +1,119 @@
+#include "nes_rom_database.h"
+
+namespace NES_Emulator {
+  static_assert(sizeof(NES_ROM_Database::entry) == 24, "Database entries are 24 bytes on disk");
+
+  std::mutex NES_ROM_Database::lock;
+  NES_ROM_Pool::image* NES_ROM_Database::file = nullptr;
+  const NES_ROM_Database::entry* NES_ROM_Database::slots = nullptr;
+  uint32_t NES_ROM_Database::slot_count = 0;
+
+  bool NES_ROM_Database::open(const std::string &file_name) {
+    NES_ROM_Pool::image* image = NES_ROM_Pool::acquire(file_name);
+
+    if (!image)
+      return false;
+
+    // The version doubles as a byte order mark, a big endian host reads it swapped.
+    file_header header;
+    bool valid = image->size >= sizeof(file_header);
+
+    if (valid) {
+      memcpy(&header, image->data, sizeof(file_header));
+      valid = memcmp(header.magic, "NESD", 4) == 0 && header.version == VERSION && header.slot_count > 0 &&
+        (header.slot_count & (header.slot_count - 1)) == 0 &&
+        (image->size - sizeof(file_header)) / sizeof(entry) >= header.slot_count;
+    }
+
+    if (!valid) {
+      NES_ROM_Pool::release(image);
+      return false;
+    }
+
+    close();
+
+    std::lock_guard<std::mutex> guard(lock);
+    file = image;
+    slots = (const entry*)(image->data + sizeof(file_header));
+    slot_count = header.slot_count;
+
+    return true;
+  }
+
+  void NES_ROM_Database::close() {
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (file)
+      NES_ROM_Pool::release(file);
+
+    file = nullptr;
+    slots = nullptr;
+    slot_count = 0;
+  }
+
+  bool NES_ROM_Database::is_open() {
+    std::lock_guard<std::mutex> guard(lock);
+    return file != nullptr;
+  }
+
+  bool NES_ROM_Database::find(uint32_t crc, entry &result) {
+    std::lock_guard<std::mutex> guard(lock);
+
+    // Linear probing from the CRC's home slot up to the first empty one.
+    for (uint32_t i = 0; i < slot_count; i++) {
+      const entry &slot = slots[(crc + i) & (slot_count - 1)];
+
+      if (!(slot.flags & FLAG_USED))
+        return false;
+
+      // An entry out of range is ignored, the cartridge keeps what its header says.
+      if (slot.crc == crc) {
+        if (!is_valid(slot))
+          return false;
+
+        result = slot;
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  bool NES_ROM_Database::is_valid(const entry &game) {
+    return game.mirror <= ONE_SCREEN_HI && game.region <= nes_region_dendy &&
+      game.prg_ram_shift <= MAX_RAM_SHIFT && game.prg_nvram_shift <= MAX_RAM_SHIFT &&
+      game.chr_ram_shift <= MAX_RAM_SHIFT && game.chr_nvram_shift <= MAX_RAM_SHIFT;
+  }
+
+  bool NES_ROM_Database::write(const std::string &file_name, const std::vector<entry> &entries) {
+    // At most half full, so probes stay short.
+    uint32_t count = 1;
+
+    while (count < entries.size() * 2)
+      count <<= 1;
+
+    std::vector<entry> table(count);
+    memset(table.data(), 0, count * sizeof(entry));
+
+    for (entry game : entries) {
+      uint32_t slot = game.crc & (count - 1);
+
+      while ((table[slot].flags & FLAG_USED) && table[slot].crc != game.crc)
+        slot = (slot + 1) & (count - 1);
+
+      game.flags |= FLAG_USED;
+      table[slot] = game;
+    }
+
+    file_header header = { { 'N', 'E', 'S', 'D' }, VERSION, count, (uint32_t)entries.size() };
+    std::ofstream ofs(file_name, std::ofstream::binary);
+
+    if (!ofs.is_open())
+      return false;
+
+    ofs.write((const char*)&header, sizeof(header));
+    ofs.write((const char*)table.data(), count * sizeof(entry));
+
+    return ofs.good();
+  }
+}
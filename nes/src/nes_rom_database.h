@@ -0,0 +1,66 @@
+#include "nes.h"
+#include "nes_rom_pool.h"
+
+namespace NES_Emulator {
+  /**
+   * Known-good board details for ROMs with wrong or missing headers. The
+   * file is an open addressing hash table keyed by the CRC32 of everything
+   * after the iNES header and trainer, mapped straight from disk so a
+   * lookup touches one or two slots however many games it holds.
+   */
+  class NES_ROM_Database {
+  public:
+    // One game, 24 bytes on disk, little endian
+    struct entry {
+      uint32_t crc;
+      uint32_t prg_rom_size;
+      uint32_t chr_rom_size;
+      uint16_t mapper;
+      uint8_t submapper;
+      uint8_t mirror;          // mirror_mode
+      uint8_t flags;           // FLAG_*
+      uint8_t region;          // nes_region
+      uint8_t prg_ram_shift;   // RAM sizes as NES 2.0 shift counts, 64 << n bytes, 0 for none
+      uint8_t prg_nvram_shift;
+      uint8_t chr_ram_shift;
+      uint8_t chr_nvram_shift;
+      uint8_t reserved[2];
+    };
+
+    static const uint8_t FLAG_USED = 0x80;
+    static const uint8_t FLAG_BATTERY = 0x01;
+
+  private:
+    struct file_header {
+      char magic[4];
+      uint32_t version;
+      uint32_t slot_count; // Power of two
+      uint32_t entry_count;
+    };
+
+    static const uint32_t VERSION = 1;
+
+    // Largest RAM size shift NES 2.0 defines, 64 << 14 is 1MB
+    static const uint8_t MAX_RAM_SHIFT = 14;
+
+    static std::mutex lock;
+    static NES_ROM_Pool::image* file;
+    static const entry* slots;
+    static uint32_t slot_count;
+
+    // The file is not checked when mapped, entries are checked as they are found
+    static bool is_valid(const entry&);
+
+  public:
+    // Process-wide database, cartridges consult it while one is open
+    static bool open(const std::string&);
+    static void close();
+    static bool is_open();
+
+    // Entry for a ROM CRC32
+    static bool find(uint32_t, entry&);
+
+    // Build a database file
+    static bool write(const std::string&, const std::vector<entry>&);
+  };
+}
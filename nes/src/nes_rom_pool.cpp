@@ -0,0 +1,224 @@
+#include "nes_rom_pool.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define NES_ROM_POOL_MMAP
+#endif
+
+namespace NES_Emulator {
+  std::mutex NES_ROM_Pool::lock;
+  std::unordered_map<uint64_t, NES_ROM_Pool::image*> NES_ROM_Pool::images;
+  std::unordered_map<std::string, NES_ROM_Pool::file_entry> NES_ROM_Pool::files;
+  uint32_t NES_ROM_Pool::crc_table[8][256];
+  std::once_flag NES_ROM_Pool::crc_table_built;
+
+  uint64_t NES_ROM_Pool::hash(const BYTE* data, size_t size) {
+    // FNV-1a, 64 bit
+    uint64_t value = 0xCBF29CE484222325ULL;
+
+    for (size_t i = 0; i < size; i++)
+      value = (value ^ data[i]) * 0x100000001B3ULL;
+
+    return value;
+  }
+
+  void NES_ROM_Pool::unmap(const BYTE* data, size_t size) {
+#ifdef NES_ROM_POOL_MMAP
+    munmap((void*)data, size);
+#else
+    delete[] data;
+#endif
+  }
+
+  NES_ROM_Pool::image* NES_ROM_Pool::acquire(const std::string &file_name) {
+    std::lock_guard<std::mutex> guard(lock);
+    const BYTE* data = nullptr;
+    size_t size = 0;
+
+#ifdef NES_ROM_POOL_MMAP
+    int fd = open(file_name.c_str(), O_RDONLY);
+
+    if (fd < 0)
+      return nullptr;
+
+    struct stat info;
+
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+      close(fd);
+      return nullptr;
+    }
+
+#ifdef __APPLE__
+    const struct timespec &modified = info.st_mtimespec;
+    const struct timespec &changed = info.st_ctimespec;
+#else
+    const struct timespec &modified = info.st_mtim;
+    const struct timespec &changed = info.st_ctim;
+#endif
+
+    // An unchanged file that is already pooled is not read again.
+    file_entry entry = {
+      (uint64_t)info.st_dev, (uint64_t)info.st_ino, (uint64_t)info.st_size,
+      (int64_t)modified.tv_sec * 1000000000 + modified.tv_nsec,
+      (int64_t)changed.tv_sec * 1000000000 + changed.tv_nsec,
+      0
+    };
+    auto known = files.find(file_name);
+
+    if (known != files.end()) {
+      const file_entry &old = known->second;
+      auto pooled = images.find(old.hash);
+
+      if (old.device == entry.device && old.inode == entry.inode && old.size == entry.size &&
+          old.modified == entry.modified && old.changed == entry.changed && pooled != images.end()) {
+        close(fd);
+        pooled->second->references++;
+        return pooled->second;
+      }
+    }
+
+    size = info.st_size;
+    void* memory = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (memory == MAP_FAILED)
+      return nullptr;
+
+    data = (const BYTE*)memory;
+#else
+    std::ifstream ifs(file_name, std::ifstream::binary | std::ifstream::ate);
+
+    if (!ifs.is_open() || ifs.tellg() <= 0)
+      return nullptr;
+
+    size = ifs.tellg();
+    BYTE* buffer = new BYTE[size];
+    ifs.seekg(0);
+    ifs.read((char*)buffer, size);
+    data = buffer;
+#endif
+
+    /**
+     * The same game under another name or path still lands on the pooled
+     * copy, the new mapping is dropped and its pages are never touched again.
+     */
+    uint64_t key = hash(data, size);
+    auto pooled = images.find(key);
+
+#ifdef NES_ROM_POOL_MMAP
+    entry.hash = key;
+#endif
+
+    if (pooled != images.end() && pooled->second->size == size && memcmp(pooled->second->data, data, size) == 0) {
+#ifdef NES_ROM_POOL_MMAP
+      files[file_name] = entry;
+#endif
+      unmap(data, size);
+      pooled->second->references++;
+      return pooled->second;
+    }
+
+    // A hash collision keeps the first image pooled and this one private.
+    image* rom = new image();
+    rom->data = data;
+    rom->size = size;
+    rom->hash = key;
+    rom->references = 1;
+    rom->chr_tiles = nullptr;
+    rom->crc = 0;
+    rom->crc_offset = SIZE_MAX;
+
+    // The name only leads to the image pooled under the hash when it is this one.
+    if (pooled == images.end()) {
+      images[key] = rom;
+#ifdef NES_ROM_POOL_MMAP
+      files[file_name] = entry;
+#endif
+    }
+#ifdef NES_ROM_POOL_MMAP
+    else {
+      files.erase(file_name);
+    }
+#endif
+
+    return rom;
+  }
+
+  void NES_ROM_Pool::release(image* rom) {
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (--rom->references > 0)
+      return;
+
+    auto pooled = images.find(rom->hash);
+
+    if (pooled != images.end() && pooled->second == rom)
+      images.erase(pooled);
+
+    unmap(rom->data, rom->size);
+    delete rom->chr_tiles;
+    delete rom;
+  }
+
+  NES_Tile_Cache* NES_ROM_Pool::get_chr_tiles(image* rom, const BYTE* chr, size_t size) {
+    std::lock_guard<std::mutex> guard(lock);
+
+    // Fully decoded before it is shared, so readers on other threads never write to it.
+    if (!rom->chr_tiles) {
+      rom->chr_tiles = new NES_Tile_Cache();
+      rom->chr_tiles->attach(chr, size);
+      rom->chr_tiles->decode_all();
+    }
+
+    return rom->chr_tiles;
+  }
+  uint32_t NES_ROM_Pool::get_crc32(image* rom, size_t offset) {
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (rom->crc_offset != offset) {
+      rom->crc = offset < rom->size ? crc32(rom->data + offset, rom->size - offset) : crc32(nullptr, 0);
+      rom->crc_offset = offset;
+    }
+
+    return rom->crc;
+  }
+
+  void NES_ROM_Pool::build_crc_table() {
+    // Reflected polynomial 0xEDB88320. Table n advances a byte n positions further back.
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t value = i;
+
+      for (int bit = 0; bit < 8; bit++)
+        value = (value >> 1) ^ (value & 1 ? 0xEDB88320 : 0);
+
+      crc_table[0][i] = value;
+    }
+
+    for (uint32_t i = 0; i < 256; i++) {
+      for (int n = 1; n < 8; n++)
+        crc_table[n][i] = (crc_table[n - 1][i] >> 8) ^ crc_table[0][crc_table[n - 1][i] & 0xFF];
+    }
+  }
+
+  uint32_t NES_ROM_Pool::crc32(const BYTE* data, size_t size) {
+    std::call_once(crc_table_built, build_crc_table);
+    uint32_t crc = 0xFFFFFFFF;
+
+    // Eight bytes per step, assembled little endian so any host gets the same result.
+    for (; size >= 8; data += 8, size -= 8) {
+      uint32_t lo = crc ^ (data[0] | data[1] << 8 | data[2] << 16 | (uint32_t)data[3] << 24);
+      uint32_t hi = data[4] | data[5] << 8 | data[6] << 16 | (uint32_t)data[7] << 24;
+
+      crc = crc_table[7][lo & 0xFF] ^ crc_table[6][(lo >> 8) & 0xFF] ^ crc_table[5][(lo >> 16) & 0xFF] ^ crc_table[4][lo >> 24] ^
+        crc_table[3][hi & 0xFF] ^ crc_table[2][(hi >> 8) & 0xFF] ^ crc_table[1][(hi >> 16) & 0xFF] ^ crc_table[0][hi >> 24];
+    }
+
+    for (; size > 0; data++, size--)
+      crc = (crc >> 8) ^ crc_table[0][(crc ^ *data) & 0xFF];
+
+    return crc ^ 0xFFFFFFFF;
+  }
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#include "nes.h"
+#include "nes_tile_cache.h"
+
+namespace NES_Emulator {
+  // Process-wide pool of ROM files, keyed by content so every cartridge
+  // running the same game reads the same read-only pages.
+  class NES_ROM_Pool {
+  public:
+    struct image {
+      const BYTE* data;
+      size_t size;
+      uint64_t hash;
+      unsigned int references;
+
+      // CRC32 of the image from crc_offset on, SIZE_MAX until it is asked for
+      uint32_t crc;
+      size_t crc_offset;
+
+      // CHR ROM decoded up front, shared like the bytes it comes from
+      NES_Tile_Cache* chr_tiles;
+    };
+
+  private:
+    // File identity, so reopening an unchanged file skips reading it
+    struct file_entry {
+      uint64_t device;
+      uint64_t inode;
+      uint64_t size;
+      int64_t modified; // Nanoseconds, a rewrite within the same second has to show
+      int64_t changed;
+      uint64_t hash;
+    };
+
+    static std::mutex lock;
+    static std::unordered_map<uint64_t, image*> images;
+    static std::unordered_map<std::string, file_entry> files;
+
+    static uint64_t hash(const BYTE*, size_t);
+    static void unmap(const BYTE*, size_t);
+
+    // Slice-by-8 CRC32 tables
+    static uint32_t crc_table[8][256];
+    static std::once_flag crc_table_built;
+    static void build_crc_table();
+
+  public:
+    // The image of a file, nullptr when it can't be read. Every acquire needs a release.
+    static image* acquire(const std::string&);
+    static void release(image*);
+
+    // Tiles for CHR ROM within an image, decoded once for every cartridge
+    static NES_Tile_Cache* get_chr_tiles(image*, const BYTE*, size_t);
+
+    // CRC32 of an image from an offset to the end, computed once for every cartridge
+    static uint32_t get_crc32(image*, size_t);
+    static uint32_t crc32(const BYTE*, size_t);
+  };
+}
@@ -0,0 +1,213 @@
+#include "nes_save_file.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define NES_SAVE_FILE_MMAP
+#endif
+
+namespace NES_Emulator {
+  NES_Save_File::NES_Save_File(const std::string &path, size_t size) {
+    save.memory = nullptr;
+    save.size = size;
+    save.path = path;
+    save.mapped = false;
+    save.dirty = nullptr;
+
+#ifdef NES_SAVE_FILE_MMAP
+    int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+
+    if (fd >= 0) {
+      struct stat info;
+
+      // A new or short file grows to the RAM size, the new bytes read as zero.
+      if (fstat(fd, &info) == 0 && ((size_t)info.st_size >= size || ftruncate(fd, size) == 0)) {
+        void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+        if (memory != MAP_FAILED) {
+          save.memory = (BYTE*)memory;
+          save.mapped = true;
+        }
+      }
+
+      close(fd);
+    }
+#endif
+
+    // Without a mapping the RAM is loaded now and written back by the writer.
+    if (!save.mapped) {
+      save.memory = new BYTE[size]();
+      save.dirty = new std::atomic<uint64_t>[(size + PAGE_SIZE * 64 - 1) / (PAGE_SIZE * 64)]();
+      std::ifstream ifs(path, std::ifstream::binary);
+
+      if (ifs.is_open())
+        ifs.read((char*)save.memory, size);
+
+      // A new or short file is written whole on the first pass.
+      if (!ifs.is_open() || (size_t)ifs.gcount() < size)
+        mark_dirty(0, size);
+    }
+
+    writer &w = get_writer();
+    std::lock_guard<std::mutex> guard(w.lock);
+    w.files.push_back(this);
+
+    // Saves still open when the process exits are written before it does.
+    if (!w.running) {
+      w.running = true;
+      std::thread(run_writer).detach();
+      std::atexit(flush_all);
+    }
+  }
+
+  NES_Save_File::~NES_Save_File() {
+    // The writer syncs and releases the memory, closing never waits on the disk.
+    writer &w = get_writer();
+    std::lock_guard<std::mutex> guard(w.lock);
+    w.files.erase(std::find(w.files.begin(), w.files.end(), this));
+    w.closed.push_back(save);
+    w.wake.notify_one();
+  }
+
+  BYTE* NES_Save_File::get_memory() {
+    return save.memory;
+  }
+
+  size_t NES_Save_File::get_size() {
+    return save.size;
+  }
+
+  bool NES_Save_File::is_mapped() {
+    return save.mapped;
+  }
+
+  void NES_Save_File::mark_dirty(size_t offset, size_t length) {
+    if (!save.dirty || length == 0)
+      return;
+
+    // Set after the store, so a pass that clears the bit also sees the data.
+    for (size_t page = offset / PAGE_SIZE; page <= (offset + length - 1) / PAGE_SIZE; page++)
+      save.dirty[page / 64].fetch_or(1ull << (page % 64), std::memory_order_release);
+  }
+
+  NES_Save_File::writer &NES_Save_File::get_writer() {
+    // Never destroyed, the detached writer thread can outlive static destructors.
+    static writer* w = new writer { {}, {}, {}, {}, {}, 0, 0, false };
+    return *w;
+  }
+
+  void NES_Save_File::run_writer() {
+    writer &w = get_writer();
+    std::unique_lock<std::mutex> guard(w.lock);
+
+    while (true) {
+      bool woken = w.wake.wait_for(guard, std::chrono::milliseconds(FLUSH_INTERVAL_MS), [&w] {
+        return w.requested != w.completed || !w.closed.empty();
+      });
+
+      // Work on copies, so saves can open and close while the disk is busy.
+      uint64_t pass = w.requested;
+      std::vector<region> open;
+      std::vector<region> closed;
+      closed.swap(w.closed);
+
+      // A close only writes its own file, open ones wait for the timer or a flush.
+      if (!woken || pass != w.completed) {
+        for (NES_Save_File* file : w.files)
+          open.push_back(file->save);
+      }
+
+      guard.unlock();
+
+      for (const region &save : open)
+        write_back(save, false);
+
+      for (const region &save : closed)
+        write_back(save, true);
+
+      guard.lock();
+      w.completed = pass;
+      w.done.notify_all();
+    }
+  }
+
+  void NES_Save_File::write_back(const region &save, bool release) {
+    if (save.mapped) {
+#ifdef NES_SAVE_FILE_MMAP
+      // Only pages the CPU dirtied since the last sync are written.
+      msync(save.memory, save.size, MS_SYNC);
+
+      if (release)
+        munmap(save.memory, save.size);
+#endif
+      return;
+    }
+
+    /**
+     * Unmapped RAM is written back a run of dirty pages at a time. While it
+     * is open the CPU can store to a page during the write, and marks it
+     * again, so the next pass, or the final one on release, brings it up
+     * to date. Nothing is written when no page was stored to.
+     */
+    size_t pages = (save.size + PAGE_SIZE - 1) / PAGE_SIZE;
+    std::vector<uint64_t> dirty((pages + 63) / 64);
+    bool stored = false;
+
+    for (size_t i = 0; i < dirty.size(); i++) {
+      dirty[i] = save.dirty[i].exchange(0, std::memory_order_acquire);
+      stored |= dirty[i] != 0;
+    }
+
+    if (stored) {
+      std::fstream file(save.path, std::fstream::in | std::fstream::out | std::fstream::binary);
+
+      // A file removed while open is created again, whole.
+      if (!file.is_open()) {
+        file.open(save.path, std::fstream::out | std::fstream::binary);
+        std::fill(dirty.begin(), dirty.end(), ~0ull);
+      }
+
+      for (size_t page = 0; page < pages && file.is_open();) {
+        if (!((dirty[page / 64] >> (page % 64)) & 1)) {
+          page++;
+          continue;
+        }
+
+        size_t end = page + 1;
+
+        while (end < pages && ((dirty[end / 64] >> (end % 64)) & 1))
+          end++;
+
+        size_t start = page * PAGE_SIZE;
+        file.seekp(start);
+        file.write((const char*)save.memory + start, std::min(end * PAGE_SIZE, save.size) - start);
+        page = end;
+      }
+
+      // Pages that could not be written are tried again on the next pass.
+      if (!file.is_open() && !release) {
+        for (size_t i = 0; i < dirty.size(); i++)
+          save.dirty[i].fetch_or(dirty[i], std::memory_order_relaxed);
+      }
+    }
+
+    if (release) {
+      delete[] save.memory;
+      delete[] save.dirty;
+    }
+  }
+
+  void NES_Save_File::flush_all() {
+    writer &w = get_writer();
+    std::unique_lock<std::mutex> guard(w.lock);
+
+    if (!w.running)
+      return;
+
+    uint64_t pass = ++w.requested;
+    w.wake.notify_one();
+    w.done.wait(guard, [&w, pass] { return w.completed >= pass; });
+  }
+}
@@ -0,0 +1,65 @@
+#include "nes.h"
+
+namespace NES_Emulator {
+  /**
+   * Battery-backed RAM kept in a file. The file is mapped shared, so the
+   * emulated CPU stores straight into the page cache and the kernel tracks
+   * which pages are dirty. One background thread for the whole process
+   * syncs every open file on a timer and takes over syncing and unmapping
+   * closed ones, so emulation threads never wait on the disk.
+   */
+  class NES_Save_File {
+  private:
+    static const unsigned int FLUSH_INTERVAL_MS = 1000;
+
+    // Unmapped RAM is written back a 256 byte page at a time
+    static const size_t PAGE_SIZE = 0x100;
+
+    // Memory backing a save, owned by the writer once the file is closed
+    struct region {
+      BYTE* memory;
+      size_t size;
+      std::string path;
+      bool mapped;
+
+      // A bit per page stored to since the last write, unmapped RAM only
+      std::atomic<uint64_t>* dirty;
+    };
+
+    // The background writer, shared by every save file
+    struct writer {
+      std::mutex lock;
+      std::condition_variable wake;
+      std::condition_variable done;
+      std::vector<NES_Save_File*> files;
+      std::vector<region> closed;
+      uint64_t requested;
+      uint64_t completed;
+      bool running;
+    };
+
+    region save;
+
+    static writer &get_writer();
+    static void run_writer();
+    static void write_back(const region&, bool);
+
+  public:
+    // Opens or creates the file, zero filled up to the size
+    NES_Save_File(const std::string&, size_t);
+    ~NES_Save_File();
+
+    BYTE* get_memory();
+    size_t get_size();
+
+    // False when the file could not be mapped and the RAM is a copy written back by the writer
+    bool is_mapped();
+
+    // Stores to an unmapped copy have to be marked for the writer to see them
+    void mark_dirty(size_t, size_t);
+
+    // Wait until everything stored so far, in open and closed files, is on disk.
+    // Runs at process exit, callers only need it to read a save back while running.
+    static void flush_all();
+  };
+}
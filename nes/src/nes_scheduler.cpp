@@ -0,0 +1,59 @@
+#include "nes_scheduler.h"
+
+namespace NES_Emulator {
+  NES_Scheduler::NES_Scheduler() {
+    for (int event = 0; event < nes_event_count; event++)
+      events[event] = NEVER;
+
+    next = nes_event_vblank;
+  }
+
+  void NES_Scheduler::find_next() {
+    // Only a handful of event kinds, so a scan beats keeping a heap ordered.
+    next = nes_event_vblank;
+
+    for (int event = 1; event < nes_event_count; event++) {
+      if (events[event] < events[next])
+        next = (nes_event)event;
+    }
+  }
+
+  void NES_Scheduler::schedule(nes_event event, master_cycle_t time) {
+    events[event] = time;
+    find_next();
+  }
+
+  void NES_Scheduler::cancel(nes_event event) {
+    events[event] = NEVER;
+    find_next();
+  }
+
+  bool NES_Scheduler::is_scheduled(nes_event event) {
+    return events[event] != NEVER;
+  }
+
+  master_cycle_t NES_Scheduler::get_time(nes_event event) {
+    return events[event];
+  }
+
+  master_cycle_t NES_Scheduler::next_time() {
+    return events[next];
+  }
+
+  nes_event NES_Scheduler::pop() {
+    nes_event event = next;
+
+    events[event] = NEVER;
+    find_next();
+
+    return event;
+  }
+
+  void NES_Scheduler::serialize(NES_State &state) {
+    for (int event = 0; event < nes_event_count; event++)
+      state.value(events[event]);
+
+    if (state.is_loading())
+      find_next();
+  }
+}
@@ -0,0 +1,36 @@
+#include "nes.h"
+#include "nes_state.h"
+
+namespace NES_Emulator {
+  class NES_Scheduler {
+  public:
+    // Timestamp of an event that is not scheduled
+    static const master_cycle_t NEVER = UINT64_MAX;
+
+  private:
+    // Pending timestamp for every event, NEVER when idle
+    master_cycle_t events[nes_event_count];
+
+    // Earliest pending event
+    nes_event next;
+
+    // Helpers
+    void find_next();
+
+  public:
+    NES_Scheduler();
+
+    // Scheduling
+    void schedule(nes_event, master_cycle_t);
+    void cancel(nes_event);
+    bool is_scheduled(nes_event);
+    master_cycle_t get_time(nes_event);
+
+    // Next event
+    master_cycle_t next_time();
+    nes_event pop();
+
+    // Save states
+    void serialize(NES_State&);
+  };
+}
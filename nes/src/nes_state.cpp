@@ -0,0 +1,99 @@
+#include "nes_state.h"
+
+namespace NES_Emulator {
+  NES_State::NES_State(BYTE* data, size_t size) {
+    this->data = data;
+    this->size = data ? size : 0;
+    position = 0;
+    loading = false;
+  }
+
+  NES_State::NES_State(const BYTE* data, size_t size) {
+    // Only ever read from while loading.
+    this->data = const_cast<BYTE*>(data);
+    this->size = data ? size : 0;
+    position = 0;
+    loading = true;
+  }
+
+  bool NES_State::is_loading() {
+    return loading;
+  }
+
+  void NES_State::put(uint64_t val, unsigned int width) {
+    if (position + width <= size) {
+      for (unsigned int i = 0; i < width; i++)
+        data[position + i] = (val >> (i * 8)) & 0xFF;
+    }
+
+    position += width;
+  }
+
+  uint64_t NES_State::take(unsigned int width) {
+    uint64_t val = 0;
+
+    // Reading past the end gives zeros, the caller rejects the state by its size.
+    if (position + width <= size) {
+      for (unsigned int i = 0; i < width; i++)
+        val |= (uint64_t)data[position + i] << (i * 8);
+    }
+
+    position += width;
+    return val;
+  }
+
+  void NES_State::value(bool &val) {
+    if (loading)
+      val = take(1) != 0;
+    else
+      put(val, 1);
+  }
+
+  void NES_State::value(uint8_t &val) {
+    if (loading)
+      val = take(1);
+    else
+      put(val, 1);
+  }
+
+  void NES_State::value(uint16_t &val) {
+    if (loading)
+      val = take(2);
+    else
+      put(val, 2);
+  }
+
+  void NES_State::value(uint32_t &val) {
+    if (loading)
+      val = take(4);
+    else
+      put(val, 4);
+  }
+
+  void NES_State::value(uint64_t &val) {
+    if (loading)
+      val = take(8);
+    else
+      put(val, 8);
+  }
+
+  void NES_State::bytes(BYTE* memory, size_t length) {
+    // Memory blocks are byte arrays, copied as they are.
+    if (position + length <= size) {
+      if (loading)
+        memcpy(memory, data + position, length);
+      else
+        memcpy(data + position, memory, length);
+    }
+
+    position += length;
+  }
+
+  size_t NES_State::get_position() {
+    return position;
+  }
+
+  bool NES_State::is_complete() {
+    return position <= size;
+  }
+}
@@ -0,0 +1,43 @@
+#include "nes.h"
+
+namespace NES_Emulator {
+  /**
+   * Cursor over a save state buffer. Every component has one serialize()
+   * that both writes and reads its fields, so the two directions cannot
+   * drift apart. Values are stored little endian at fixed widths whatever
+   * the host, and nothing is allocated. A cursor without a buffer only
+   * counts, which is how the size of a state is worked out.
+   */
+  class NES_State {
+  private:
+    BYTE* data;
+    size_t size;
+    size_t position;
+    bool loading;
+
+    // Little endian values
+    void put(uint64_t, unsigned int);
+    uint64_t take(unsigned int);
+
+  public:
+    // Saving into a buffer, or counting when it is null
+    NES_State(BYTE*, size_t);
+
+    // Loading from a buffer
+    NES_State(const BYTE*, size_t);
+
+    bool is_loading();
+
+    // Fields
+    void value(bool&);
+    void value(uint8_t&);
+    void value(uint16_t&);
+    void value(uint32_t&);
+    void value(uint64_t&);
+    void bytes(BYTE*, size_t);
+
+    // Bytes used so far, past the end of the buffer when it was too small
+    size_t get_position();
+    bool is_complete();
+  };
+}
@@ -1,30 +1,308 @@
 #include "nes_system.h"
 
 namespace NES_Emulator {
-  NES_System::NES_System() {
+  NES_System::NES_System(nes_cpu_core core, nes_ppu_sync sync) {
     _bus = new NES_Bus();
-    _cpu = new NES_CPU(_bus);
-    _ppu = new NES_PPU();
+    _cartridge = nullptr;
+    _cpu = new NES_CPU(_bus, core);
+    _ppu = _bus->get_ppu();
+    _scheduler = new NES_Scheduler();
+    _bus->attach_system(this);
+
+    this->sync = sync;
+
+    master_cycle = 0;
+    cpu_cycle = 0;
+    ppu_cycle = 0;
+    batch_end = 0;
+
+    ppu_write_hook_function = nullptr;
+    ppu_write_hook_context = nullptr;
+
+    // Frame events repeat for as long as the system runs.
+    _scheduler->schedule(nes_event_vblank, VBLANK_START);
+    _scheduler->schedule(nes_event_vblank_end, VBLANK_END);
+  }
+
+  NES_System::~NES_System() {
+    delete _cpu;
+    delete _bus;
+    delete _scheduler;
+  }
+
+  void NES_System::insert_cartridge(NES_Cartridge* cartridge) {
+    _cartridge = cartridge;
+    _bus->insert_cartridge(cartridge);
+    _ppu->insert_cartridge(cartridge);
+  }
+
+  void NES_System::reset() {
+    cpu_cycle += _cpu->reset() * PPU_CYCLES_PER_CPU_CYCLE;
+  }
+
+  NES_CPU* NES_System::get_cpu() {
+    return _cpu;
+  }
+
+  NES_Scheduler* NES_System::get_scheduler() {
+    return _scheduler;
   }
 
   void NES_System::clock() {
-    if (ppu_cycles >= 341) {
-      ppu_cycles -= 341;
-      scanline += 1;
+    run_until(master_cycle + 1);
+  }
+
+  void NES_System::run_until(master_cycle_t target) {
+    /**
+     * The CPU runs ahead in one batch of instructions up to the next event
+     * or the target, then the PPU is caught up to the same timestamp and
+     * any events that are due are handled.
+     */
+    while (master_cycle < target) {
+      schedule_sprite_zero_hit();
+      schedule_mapper_irq();
+
+      master_cycle_t next = std::min(_scheduler->next_time(), target);
+
+      if (next > master_cycle) {
+        next = run_cpu(next);
+        run_ppu(next);
+        master_cycle = next;
+      }
+
+      while (_scheduler->next_time() <= master_cycle) {
+        master_cycle_t time = _scheduler->next_time();
+        handle_event(_scheduler->pop(), time);
+      }
+    }
+  }
 
-      if (scanline >= 262) {
-        scanline = 0;
+  void NES_System::run_frame() {
+    run_until((_ppu->get_frame() + 1) * DOTS_PER_FRAME);
+  }
+
+  master_cycle_t NES_System::run_cpu(master_cycle_t target) {
+    // The last instruction may finish past the target, the next batch starts from there.
+    while (cpu_cycle < target) {
+      /**
+       * IRQs are level triggered: the line stays up until the mapper is
+       * acknowledged, and is taken as soon as I is clear. While I holds it
+       * off the CPU runs an instruction at a time to notice I clearing.
+       */
+      bool irq = _cartridge && _cartridge->get_irq();
+
+      if (irq) {
+        cpu_cycle += _cpu->IRQ() * PPU_CYCLES_PER_CPU_CYCLE;
+
+        if (cpu_cycle >= target)
+          break;
       }
+
+      master_cycle_t budget = (target - cpu_cycle + PPU_CYCLES_PER_CPU_CYCLE - 1) / PPU_CYCLES_PER_CPU_CYCLE;
+
+      if (budget > MAX_CPU_BATCH)
+        budget = MAX_CPU_BATCH;
+
+      // Lockstep runs one instruction at a time, for checking catch-up against.
+      if (sync == nes_ppu_sync_lockstep || irq)
+        budget = 1;
+
+      batch_end = cpu_cycle + budget * PPU_CYCLES_PER_CPU_CYCLE;
+      cpu_cycle += _cpu->run(budget) * PPU_CYCLES_PER_CPU_CYCLE;
+      batch_end = 0;
+
+      if (sync == nes_ppu_sync_lockstep)
+        run_ppu(std::min(cpu_cycle, target));
+
+      // An event scheduled during the batch ended it early, stop there instead.
+      target = std::min(target, _scheduler->next_time());
     }
 
-    if (cpu_cycles == 0) {
-      opcode_t opcode = _bus->cpu_read(_cpu->PC()++);
-      cpu_cycles = _cpu->run_instruction(opcode);
+    return target;
+  }
+
+  void NES_System::run_ppu(master_cycle_t target) {
+    // The PPU never runs backwards, a CPU access may already have brought it past the target.
+    if (target <= ppu_cycle)
+      return;
+
+    _ppu->run(target - ppu_cycle);
+    ppu_cycle = target;
+  }
+
+  void NES_System::sync_ppu() {
+    run_ppu(cpu_cycle + _cpu->get_batch_cycles() * PPU_CYCLES_PER_CPU_CYCLE);
+  }
+
+  void NES_System::handle_event(nes_event event, master_cycle_t time) {
+    switch (event) {
+      case nes_event_vblank:
+        if (_ppu->start_vblank())
+          cpu_cycle += _cpu->NMI() * PPU_CYCLES_PER_CPU_CYCLE;
+
+        _scheduler->schedule(nes_event_vblank, time + DOTS_PER_FRAME);
+        break;
+      case nes_event_vblank_end:
+        _ppu->end_vblank();
+        _scheduler->schedule(nes_event_vblank_end, time + DOTS_PER_FRAME);
+        break;
+      // A write during the batch can have moved or cancelled the hit since it was scheduled.
+      case nes_event_sprite_zero_hit:
+        if (_ppu->get_sprite_zero_hit() <= time)
+          _ppu->set_sprite_zero_hit();
+        break;
+      // The PPU clocked the mapper up to here, run_cpu takes the IRQ when the line is up.
+      case nes_event_mapper_irq:
+        break;
+      default:
+        break;
     }
+  }
+
+  void NES_System::schedule_sprite_zero_hit() {
+    // The PPU predicts the hit, the batch before it has to stop there.
+    master_cycle_t time = _ppu->get_sprite_zero_hit();
+
+    if (time == NES_PPU::NO_SPRITE_ZERO_HIT)
+      _scheduler->cancel(nes_event_sprite_zero_hit);
+    else if (_scheduler->get_time(nes_event_sprite_zero_hit) != time)
+      _scheduler->schedule(nes_event_sprite_zero_hit, time);
+
+    // A write in the middle of a batch can bring the hit before where the batch stops.
+    if (time < batch_end)
+      _cpu->end_batch();
+  }
+
+  void NES_System::set_ppu_write_hook(ppu_write_hook hook, void* context) {
+    ppu_write_hook_function = hook;
+    ppu_write_hook_context = context;
+  }
+
+  void NES_System::trace_ppu_write(address_t address, BYTE val) {
+    if (ppu_write_hook_function)
+      ppu_write_hook_function(ppu_write_hook_context, address, val, _ppu->get_position());
+  }
+
+  void NES_System::schedule_mapper_irq() {
+    // The mapper counts scanlines, the PPU knows when they come.
+    master_cycle_t time = NES_PPU::NO_SCANLINE_CLOCK;
+
+    if (_cartridge)
+      time = _ppu->get_scanline_clock(_cartridge->get_irq_scanlines());
+
+    if (time == NES_PPU::NO_SCANLINE_CLOCK)
+      _scheduler->cancel(nes_event_mapper_irq);
+    else if (_scheduler->get_time(nes_event_mapper_irq) != time)
+      _scheduler->schedule(nes_event_mapper_irq, time);
+
+    // A write in the middle of a batch can bring the IRQ before where the batch stops.
+    if (time < batch_end)
+      _cpu->end_batch();
+  }
+
+  void NES_System::stall_cpu(unsigned int cycles) {
+    _cpu->stall(cycles);
+  }
+
+  master_cycle_t NES_System::get_master_cycle() {
+    return master_cycle;
+  }
+
+  uint64_t NES_System::get_frame() {
+    return _ppu->get_frame();
+  }
+
+  unsigned int NES_System::get_scanline() {
+    return _ppu->get_scanline();
+  }
+
+  unsigned int NES_System::get_dot() {
+    return _ppu->get_dot();
+  }
+
+  NES_Frame* NES_System::get_screen() {
+    return _ppu->get_screen();
+  }
+
+  void NES_System::set_render_interval(unsigned int interval) {
+    _ppu->set_render_interval(interval);
+  }
+
+  bool NES_System::is_frame_rendered(uint64_t frame) {
+    return _ppu->is_frame_rendered(frame);
+  }
+
+  void NES_System::serialize(NES_State &state) {
+    state.value(master_cycle);
+    state.value(cpu_cycle);
+    state.value(ppu_cycle);
+    _scheduler->serialize(state);
+
+    // Banks first, the bus and PPU remap from them when loading.
+    if (_cartridge)
+      _cartridge->serialize(state);
+
+    _cpu->serialize(state);
+    _bus->serialize(state);
+    _ppu->serialize(state);
+  }
+
+  size_t NES_System::get_state_size() {
+    NES_State counter((BYTE*)nullptr, 0);
+    serialize(counter);
+
+    return STATE_HEADER_SIZE + counter.get_position();
+  }
+
+  bool NES_System::save_state(BYTE* buffer, size_t size) {
+    if (size < STATE_HEADER_SIZE)
+      return false;
+
+    NES_State body(buffer + STATE_HEADER_SIZE, size - STATE_HEADER_SIZE);
+    serialize(body);
+
+    if (!body.is_complete())
+      return false;
+
+    // The header goes last, once the size is known.
+    uint32_t magic = STATE_MAGIC;
+    uint32_t version = STATE_VERSION;
+    uint32_t length = STATE_HEADER_SIZE + body.get_position();
+    uint64_t rom = _cartridge ? _cartridge->get_rom_hash() : 0;
+
+    NES_State header(buffer, STATE_HEADER_SIZE);
+    header.value(magic);
+    header.value(version);
+    header.value(length);
+    header.value(rom);
+
+    return true;
+  }
+
+  bool NES_System::load_state(const BYTE* buffer, size_t size) {
+    if (size < STATE_HEADER_SIZE)
+      return false;
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t length;
+    uint64_t rom;
+
+    NES_State header(buffer, STATE_HEADER_SIZE);
+    header.value(magic);
+    header.value(version);
+    header.value(length);
+    header.value(rom);
+
+    if (magic != STATE_MAGIC || version != STATE_VERSION || length > size)
+      return false;
+
+    if (rom != (_cartridge ? _cartridge->get_rom_hash() : 0) || length != get_state_size())
+      return false;
+
+    NES_State body(buffer + STATE_HEADER_SIZE, length - STATE_HEADER_SIZE);
+    serialize(body);
 
-    if (ppu_cycles % 3 == 0)
-      cpu_cycles--;
-    
-    ppu_cycles++;
+    return true;
   }
-}
\ No newline at end of file
+}
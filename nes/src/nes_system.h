@@ -2,16 +2,43 @@
 #include "nes_cpu.h"
 #include "nes_ppu.h"
 #include "nes_bus.h"
+#include "nes_scheduler.h"
+#include "nes_state.h"
 
 namespace NES_Emulator {
   class NES_System {
+  public:
+    // Debugging, called with the register, the value and the PPU position
+    typedef void (*ppu_write_hook)(void*, address_t, BYTE, master_cycle_t);
+
   private:
-    // Cycles
-    cycle_t cpu_cycles;
-    cycle_t ppu_cycles;
+    // Timing, in master cycles (one PPU dot each)
+    static const master_cycle_t PPU_CYCLES_PER_CPU_CYCLE = 3;
+    static const master_cycle_t DOTS_PER_FRAME = NES_PPU::DOTS_PER_FRAME;
+
+    // Event times within a frame
+    static const master_cycle_t VBLANK_START = 241 * NES_PPU::DOTS_PER_SCANLINE + 1;
+    static const master_cycle_t VBLANK_END = 261 * NES_PPU::DOTS_PER_SCANLINE + 1;
+
+    // Longest run handed to the CPU at once, in CPU cycles
+    static const master_cycle_t MAX_CPU_BATCH = 0x100000;
+
+    // Save state header: magic, version, total size and the ROM's content hash.
+    // Version 2 dropped the APU frame IRQ from the scheduled events.
+    static const uint32_t STATE_MAGIC = 0x5353454E; // "NESS"
+    static const uint32_t STATE_VERSION = 2;
+    static const size_t STATE_HEADER_SIZE = 20;
+
+    // Master clock and how far each processor has run
+    master_cycle_t master_cycle;
+    master_cycle_t cpu_cycle;
+    master_cycle_t ppu_cycle;
+
+    // Where the CPU batch in progress stops, 0 outside of one
+    master_cycle_t batch_end;
 
-    // Scanline
-    BYTE scanline;
+    // How the PPU is kept up with the CPU
+    nes_ppu_sync sync;
 
     // Processors
     NES_CPU* _cpu;
@@ -19,9 +46,83 @@ namespace NES_Emulator {
 
     // Memory
     NES_Bus* _bus;
+    NES_Cartridge* _cartridge;
+
+    // Events
+    NES_Scheduler* _scheduler;
+
+    // Debugging
+    ppu_write_hook ppu_write_hook_function;
+    void* ppu_write_hook_context;
+
+    // Catch up
+    master_cycle_t run_cpu(master_cycle_t);
+    void run_ppu(master_cycle_t);
+
+    // Events
+    void handle_event(nes_event, master_cycle_t);
+
+    // Save states
+    void serialize(NES_State&);
 
   public:
-    NES_System();
+    NES_System(nes_cpu_core = nes_cpu_core_table, nes_ppu_sync = nes_ppu_sync_catch_up);
+    ~NES_System();
+
+    // Owns the processors, bus and scheduler, the cartridge stays the caller's
+    NES_System(const NES_System&) = delete;
+    NES_System &operator=(const NES_System&) = delete;
+
+    // Cartridge
+    void insert_cartridge(NES_Cartridge*);
+    void reset();
+
+    // Processors, for debuggers and tests
+    NES_CPU* get_cpu();
+
+    // Events
+    NES_Scheduler* get_scheduler();
+
+    // Run
     void clock();
+    void run_until(master_cycle_t);
+    void run_frame();
+
+    // Bring the PPU up to the CPU, before the CPU touches PPU state
+    void sync_ppu();
+
+    // Halt the CPU, for DMA
+    void stall_cpu(unsigned int);
+
+    // Predict the next sprite 0 hit and mapper IRQ, after writes that can move them
+    void schedule_sprite_zero_hit();
+    void schedule_mapper_irq();
+
+    // Debugging, see every PPU register write once the PPU has caught up to it
+    void set_ppu_write_hook(ppu_write_hook, void*);
+    void trace_ppu_write(address_t, BYTE);
+
+    // Timing
+    master_cycle_t get_master_cycle();
+    uint64_t get_frame();
+    unsigned int get_scanline();
+    unsigned int get_dot();
+
+    // Output
+    NES_Frame* get_screen();
+
+    // Draw every Nth frame, 0 to skip pixel generation entirely
+    void set_render_interval(unsigned int);
+    bool is_frame_rendered(uint64_t);
+
+    /**
+     * Save states, between runs. The layout is fixed for a given cartridge,
+     * get_state_size() bytes, and neither call allocates. Loading checks the
+     * header first and leaves the system untouched when the state is from
+     * another version, another ROM or is cut short.
+     */
+    size_t get_state_size();
+    bool save_state(BYTE*, size_t);
+    bool load_state(const BYTE*, size_t);
   };
 }
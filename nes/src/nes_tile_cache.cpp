@@ -0,0 +1,63 @@
+#include "nes_tile_cache.h"
+
+namespace NES_Emulator {
+  NES_Tile_Cache::NES_Tile_Cache() {
+    chr = nullptr;
+    tile_count = 0;
+    memset(blank, 0, sizeof(blank));
+  }
+
+  void NES_Tile_Cache::attach(const BYTE* chr, size_t size) {
+    this->chr = chr;
+    tile_count = size / TILE_BYTES;
+
+    pixels = std::vector<BYTE>(tile_count * TILE_PIXELS * 2, 0);
+    decoded = std::vector<bool>(tile_count, false);
+  }
+
+  void NES_Tile_Cache::decode(size_t tile) {
+    const BYTE* planes = chr + tile * TILE_BYTES;
+    BYTE* normal = pixels.data() + tile * TILE_PIXELS * 2;
+    BYTE* flipped = normal + TILE_PIXELS;
+
+    for (int y = 0; y < 8; y++) {
+      BYTE lo = planes[y];
+      BYTE hi = planes[y + 8];
+
+      for (int x = 0; x < 8; x++) {
+        BYTE value = ((lo >> (7 - x)) & 1) | (((hi >> (7 - x)) & 1) << 1);
+        normal[y * 8 + x] = value;
+        flipped[y * 8 + 7 - x] = value;
+      }
+    }
+
+    decoded[tile] = true;
+  }
+
+  const BYTE* NES_Tile_Cache::get(uint32_t offset, bool flip) {
+    size_t tile = offset / TILE_BYTES;
+
+    if (tile >= tile_count)
+      return blank;
+
+    if (!decoded[tile])
+      decode(tile);
+
+    return pixels.data() + tile * TILE_PIXELS * 2 + (flip ? TILE_PIXELS : 0);
+  }
+
+  void NES_Tile_Cache::invalidate(uint32_t offset, uint32_t length) {
+    size_t first = offset / TILE_BYTES;
+    size_t last = std::min<size_t>((offset + length + TILE_BYTES - 1) / TILE_BYTES, tile_count);
+
+    for (size_t tile = first; tile < last; tile++)
+      decoded[tile] = false;
+  }
+
+  void NES_Tile_Cache::decode_all() {
+    for (size_t tile = 0; tile < tile_count; tile++) {
+      if (!decoded[tile])
+        decode(tile);
+    }
+  }
+}
\ No newline at end of file
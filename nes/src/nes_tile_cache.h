@@ -0,0 +1,39 @@
+#include "nes.h"
+
+namespace NES_Emulator {
+  class NES_Tile_Cache {
+  public:
+    // A tile is 16 bytes of CHR, two 8x8 bitplanes
+    static const unsigned int TILE_BYTES = 16;
+    static const unsigned int TILE_PIXELS = 64;
+
+  private:
+    // CHR memory the tiles are decoded from
+    const BYTE* chr;
+    size_t tile_count;
+
+    // 2-bit pixels, row by row, then the same tile flipped horizontally
+    std::vector<BYTE> pixels;
+    std::vector<bool> decoded;
+
+    // Returned when there is no CHR memory at all
+    BYTE blank[TILE_PIXELS * 2];
+
+    void decode(size_t);
+
+  public:
+    NES_Tile_Cache();
+
+    // CHR memory
+    void attach(const BYTE*, size_t);
+
+    // Pixels for the tile at a CHR offset
+    const BYTE* get(uint32_t, bool);
+
+    // Invalidation, for CHR RAM writes
+    void invalidate(uint32_t, uint32_t);
+
+    // Decode every tile now, after which get() only reads
+    void decode_all();
+  };
+}
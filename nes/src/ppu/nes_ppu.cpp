@@ -1,21 +1,74 @@
 #include "nes_ppu.h"
 
 namespace NES_Emulator {
-  address_t NES_PPU::mirror_vram_addr(address_t address) {
-    address_t mirrored_address = address & 0x2FFF;
-    address_t vram_index = mirrored_address - 0x2000;
-    uint8_t name_table = vram_index / 0x0400;
-    mirror_mode mirror = cartridge->get_mirror_mode();
+  void NES_PPU::map_chr() {
+    // Pattern tables, 1KB at a time so mappers with small CHR banks fit.
+    for (int page = 0; page < 8; page++) {
+      address_t address = page * 0x0400;
+      pages[page].memory = cartridge->get_chr_page(address);
+      pages[page].chr_offset = cartridge->get_chr_offset(address);
+    }
+
+    mapped_chr_generation = cartridge->get_chr_generation();
+    invalidate_background();
+    sprite_zero_hit_stale = true;
+  }
 
-    if (mirror == mirror_mode::VERTICAL && (name_table == 2 || name_table == 3)) {
-      return vram_index - 0x0800;
-    } else if (mirror == mirror_mode::HORIZONTAL && (name_table == 1 || name_table == 2)) {
-      return vram_index - 0x0400;
-    } else if (mirror == mirror_mode::HORIZONTAL && name_table == 3) {
-      return vram_index - 0x0800;
+  void NES_PPU::map_nametables(mirror_mode mirror) {
+    /**
+     * The console has 2KB of VRAM, two nametables. Four-screen carts add
+     * the other two, the upper half of vram. $3000-$3FFF mirrors $2000-$2FFF.
+     */
+    static const BYTE LAYOUTS[5][4] = {
+      { 0, 1, 0, 1 }, // VERTICAL
+      { 0, 0, 1, 1 }, // HORIZONTAL
+      { 0, 1, 2, 3 }, // FOUR_SCREEN
+      { 0, 0, 0, 0 }, // ONE_SCREEN_LO
+      { 1, 1, 1, 1 }, // ONE_SCREEN_HI
+    };
+
+    for (int page = 8; page < 16; page++) {
+      pages[page].memory = vram + LAYOUTS[mirror][page & 0x03] * 0x0400;
+      pages[page].chr_offset = 0;
     }
 
-    return vram_index;
+    /**
+     * One layer plane per nametable that exists. Planes follow VRAM rather
+     * than the mirroring, so mappers that switch it at runtime keep them.
+     */
+    unsigned int planes = mirror == FOUR_SCREEN ? 4 : 2;
+
+    if (background_dirty.size() != planes * NAMETABLE_TILES) {
+      background_plane.resize(planes * NAMETABLE_PIXELS);
+      background_dirty.resize(planes * NAMETABLE_TILES);
+      invalidate_background();
+    }
+
+    this->mirror = mirror;
+    sprite_zero_hit_stale = true;
+  }
+
+  BYTE NES_PPU::read_vram(address_t address) {
+    return pages[(address >> 10) & 0x0F].memory[address & 0x03FF];
+  }
+
+  uint32_t NES_PPU::chr_offset(address_t address) {
+    return pages[address >> 10].chr_offset + (address & 0x03FF);
+  }
+
+  BYTE NES_PPU::read_palette(BYTE index) {
+    // $3F10/$3F14/$3F18/$3F1C mirror the background entries.
+    if ((index & 0x13) == 0x10)
+      index &= 0x0F;
+
+    return palette_table[index];
+  }
+
+  void NES_PPU::write_palette(BYTE index, BYTE val) {
+    if ((index & 0x13) == 0x10)
+      index &= 0x0F;
+
+    palette_table[index] = val;
   }
 
   NES_PPU::NES_PPU() {
@@ -24,6 +77,44 @@ namespace NES_Emulator {
     status = new NES_PPU_Status_Register();
     scroll = new NES_PPU_Scroll_Register();
     addr = new NES_PPU_Address_Register();
+
+    screen = new NES_Frame();
+    render_interval = 1;
+    emphasis = 0;
+    compose = NES_PPU_Line_Kernel::select();
+    grayscale = 0x3F;
+    cartridge = nullptr;
+    internal_buf = 0;
+    oam_address = 0;
+
+    memset(palette_table, 0, sizeof(palette_table));
+    memset(vram, 0, sizeof(vram));
+    background_bank = 0;
+    map_nametables(HORIZONTAL);
+
+    // Pattern tables read as VRAM until a cartridge is inserted.
+    for (int page = 0; page < 8; page++)
+      pages[page] = pages[8];
+
+    mapped_chr_generation = 0;
+    memset(oam_data, 0, sizeof(oam_data));
+
+    line_sprite_count = 0;
+    sprite_zero_hit_time = NO_SPRITE_ZERO_HIT;
+    sprite_zero_hit_stale = true;
+
+    dot = 0;
+    scanline = 0;
+    frame = 0;
+  }
+
+  NES_PPU::~NES_PPU() {
+    delete control;
+    delete mask;
+    delete status;
+    delete scroll;
+    delete addr;
+    delete screen;
   }
 
   void NES_PPU::increment_vram_addr() {
@@ -32,14 +123,88 @@ namespace NES_Emulator {
 
   void NES_PPU::write_to_control(BYTE v) {
     control->set(v);
+    scroll->write_control(v);
+    sprite_zero_hit_stale = true;
+
+    // The background layer was decoded from the other pattern table.
+    if (control->get_background_pattern_addr() != background_bank) {
+      background_bank = control->get_background_pattern_addr();
+      invalidate_background();
+    }
   }
 
   void NES_PPU::write_to_mask(BYTE v) {
     mask->set(v);
+
+    // Grayscale keeps only the column of gray shades, $x0.
+    emphasis = (v >> 5) << 6;
+    grayscale = mask->get_flag(NES_PPU_Mask_Register::flag::GS) ? 0x30 : 0x3F;
+    sprite_zero_hit_stale = true;
   }
 
   BYTE NES_PPU::read_status() {
-    status->get();
+    // A hit already passed is seen here even when its event has not been handled yet.
+    if (get_sprite_zero_hit() <= get_position())
+      set_sprite_zero_hit();
+
+    BYTE value = status->get();
+
+    // Reading the status acknowledges vblank and resets the $2005/$2006 latch.
+    status->clear_flag(NES_PPU_Status_Register::flag::VBS);
+    scroll->reset_latch();
+    addr->reset_latch();
+
+    return value;
+  }
+
+  bool NES_PPU::start_vblank() {
+    status->set_flag(NES_PPU_Status_Register::flag::VBS);
+
+    // NMI is only raised when enabled in PPUCTRL.
+    return control->get_flag(NES_PPU_Control_Register::flag::NMI);
+  }
+
+  void NES_PPU::end_vblank() {
+    status->clear_flag(NES_PPU_Status_Register::flag::VBS);
+    status->clear_flag(NES_PPU_Status_Register::flag::SZH);
+    status->clear_flag(NES_PPU_Status_Register::flag::SOF);
+    sprite_zero_hit_stale = true;
+  }
+
+  void NES_PPU::set_sprite_zero_hit() {
+    status->set_flag(NES_PPU_Status_Register::flag::SZH);
+    sprite_zero_hit_stale = true;
+  }
+
+  master_cycle_t NES_PPU::get_sprite_zero_hit() {
+    if (sprite_zero_hit_stale) {
+      sprite_zero_hit_time = predict_sprite_zero_hit();
+      sprite_zero_hit_stale = false;
+    }
+
+    return sprite_zero_hit_time;
+  }
+
+  master_cycle_t NES_PPU::get_scanline_clock(unsigned int count) {
+    if (count == 0 || !rendering_enabled())
+      return NO_SCANLINE_CLOCK;
+
+    // Clocks come at the end of the visible part of every rendered line.
+    master_cycle_t line = get_position() - dot;
+    unsigned int y = scanline;
+
+    if (dot >= LINE_END_DOT) {
+      line += DOTS_PER_SCANLINE;
+      y = (y + 1) % SCANLINES_PER_FRAME;
+    }
+
+    while (true) {
+      if ((y < VISIBLE_SCANLINES || y == PRE_RENDER_SCANLINE) && --count == 0)
+        return line + LINE_END_DOT;
+
+      line += DOTS_PER_SCANLINE;
+      y = (y + 1) % SCANLINES_PER_FRAME;
+    }
   }
 
   BYTE NES_PPU::read_oam_data() {
@@ -53,153 +218,551 @@ namespace NES_Emulator {
   void NES_PPU::write_to_oam_data(BYTE val) {
     oam_data[oam_address] = val;
     oam_address = (int)oam_address + 1;
+    sprite_zero_hit_stale = true;
+  }
+
+  void NES_PPU::write_to_scroll(BYTE v) {
+    scroll->write(v);
+    sprite_zero_hit_stale = true;
   }
 
   void NES_PPU::write_to_ppu_addr(BYTE v) {
-    addr->update(v);
+    // The VRAM address is loaded from t once both halves are written.
+    if (scroll->write_address(v))
+      addr->set(scroll->temp);
+
+    sprite_zero_hit_stale = true;
   }
 
   void NES_PPU::write_to_ppu_data(BYTE v) {
-    address_t address = addr->get();
+    address_t address = addr->get() & 0x3FFF;
     increment_vram_addr();
+    sprite_zero_hit_stale = true;
     
-    if (address >= 0x2000 && address <= 0x2FFF)
-      vram[mirror_vram_addr(address)] = v;
-    else if (address == 0x3F10 || address == 0x3F14 || address == 0x3F18 || address == 0x3F1C)
-      palette_table[address - 0x10 - 0x3F00] = v;
-    else if (address <= 0x3000 && address >= 0x3FFF)
-      palette_table[address - 0x3F00] = v;
+    // CHR RAM writes go through the cartridge, which keeps its tile cache current.
+    if (address <= 0x1FFF) {
+      cartridge->write_chr_memory(address, v);
+
+      if ((address & 0x1000) == background_bank) {
+        dirty_patterns[(address >> 4) & 0xFF] = 1;
+        patterns_dirty = true;
+      }
+    } else if (address <= 0x3EFF) {
+      vram[physical_nametable((address >> 10) & 0x03) * 0x0400 + (address & 0x03FF)] = v;
+      mark_background_dirty(address);
+    } else {
+      write_palette(address & 0x1F, v);
+    }
   }
 
   BYTE NES_PPU::read() {
-    address_t address = addr->get();
+    address_t address = addr->get() & 0x3FFF;
     BYTE result = internal_buf;
     increment_vram_addr();
     
-    if (address >= 0x0000 && address <= 0x1FFF)
-      internal_buf = cartridge->read_chr_memory(address);
-    else if (address >= 0x2000 && address <= 0x2FFF)
-      internal_buf = vram[mirror_vram_addr(address)];
-    else if (address == 0x3F10 || address == 0x3F14 || address == 0x3F18 || address == 0x3F1C)
-      internal_buf = palette_table[address - 0x10 - 0x3F00];
-    else if (address <= 0x3000 && address >= 0x3FFF)
-      internal_buf = palette_table[address - 0x3F00];
+    // Palette reads skip the buffer, which picks up the nametable byte underneath.
+    internal_buf = read_vram(address);
+
+    if (address >= 0x3F00)
+      result = read_palette(address & 0x1F);
 
     return result;
   }
 
   void NES_PPU::insert_cartridge(NES_Cartridge* cartridge) {
     this->cartridge = cartridge;
+    map_chr();
+    map_nametables(cartridge->get_mirror_mode());
   }
 
-  std::vector<uint8_t> NES_PPU::background_palette(BYTE tile_col, BYTE tile_row) {
-    uint8_t attr_table_idx = tile_row / 4 * 8 +  tile_col / 4;
-    BYTE attr_byte = vram[0x3C0 + attr_table_idx];
-    BYTE palette_idx;
+  void NES_PPU::update_banks() {
+    // Mapper writes can switch CHR banks or mirroring, pages only change when they do.
+    if (!cartridge)
+      return;
 
-    switch ((tile_col % 4 / 2) << 1 | (tile_row % 4 / 2)) {
-      case 0:
-        palette_idx = attr_byte & 0b11;
-        break;
-      case 1:
-        palette_idx = (attr_byte >> 2) & 0b11;
-        break;
-      case 2:
-        palette_idx = (attr_byte >> 4) & 0b11;
-        break;
-      case 3:
-        palette_idx = (attr_byte >> 6) & 0b11;
-        break;
+    if (cartridge->get_chr_generation() != mapped_chr_generation)
+      map_chr();
+
+    if (cartridge->get_mirror_mode() != mirror)
+      map_nametables(cartridge->get_mirror_mode());
+  }
+
+  NES_Frame* NES_PPU::get_screen() {
+    return screen;
+  }
+
+  void NES_PPU::set_render_interval(unsigned int interval) {
+    render_interval = interval;
+  }
+
+  bool NES_PPU::is_frame_rendered(uint64_t frame) {
+    return render_interval && frame % render_interval == 0;
+  }
+
+  bool NES_PPU::rendering_enabled() {
+    return mask->get_flag(NES_PPU_Mask_Register::flag::SB) || mask->get_flag(NES_PPU_Mask_Register::flag::SS);
+  }
+
+  address_t NES_PPU::increment_scroll_y(address_t v) {
+    if ((v & 0x7000) != 0x7000)
+      return v + 0x1000; // Fine Y
+
+    // Coarse Y, wrapping into the vertically adjacent nametable after row 29
+    v &= ~0x7000;
+    BYTE coarse_y = (v & 0x03E0) >> 5;
+
+    if (coarse_y == 29) {
+      coarse_y = 0;
+      v ^= 0x0800;
+    } else if (coarse_y == 31) {
+      coarse_y = 0;
+    } else {
+      coarse_y++;
     }
 
-    BYTE palette_start = 1 + (palette_idx * 4);
-    return {
-      palette_table[0], 
-      palette_table[palette_start], 
-      palette_table[palette_start + 1], 
-      palette_table[palette_start + 2]
-    };
+    return (v & ~0x03E0) | (coarse_y << 5);
   }
 
-  std::vector<uint8_t> NES_PPU::sprite_palette(BYTE palette_idx) {
-    BYTE start = 0x11 + (palette_idx * 4);
-    return {
-      0,
-      palette_table[start],
-      palette_table[start + 1],
-      palette_table[start + 2]
-    };
+  address_t NES_PPU::copy_scroll_x(address_t v) {
+    return (v & ~0x041F) | (scroll->temp & 0x041F);
+  }
+
+  address_t NES_PPU::copy_scroll_y(address_t v) {
+    return (v & ~0x7BE0) | (scroll->temp & 0x7BE0);
+  }
+
+  void NES_PPU::end_scanline() {
+    /**
+     * Skipped frames produce no pixels, everything observable still happens:
+     * the scroll moves on, sprite overflow is evaluated and sprite 0 hit
+     * does not depend on the renderer.
+     */
+    if (scanline < VISIBLE_SCANLINES) {
+      if (is_frame_rendered(frame))
+        render_scanline();
+      else if (rendering_enabled())
+        evaluate_sprites();
+    }
+
+    if (!rendering_enabled())
+      return;
+
+    if (scanline < VISIBLE_SCANLINES || scanline == PRE_RENDER_SCANLINE) {
+      addr->set(copy_scroll_x(increment_scroll_y(addr->get())));
+
+      // Sprite fetches start here, which is what clocks MMC3's counter.
+      if (cartridge)
+        cartridge->scanline();
+    }
+
+    if (scanline == PRE_RENDER_SCANLINE)
+      addr->set(copy_scroll_y(addr->get()));
+  }
+
+  void NES_PPU::render_scanline() {
+    uint16_t* line = screen->get_line(scanline);
+
+    // Nothing to fetch from, the line is backdrop.
+    if (!cartridge || !rendering_enabled()) {
+      uint16_t backdrop = emphasis | (palette_table[0] & grayscale);
+
+      for (int x = 0; x < 256; x++)
+        line[x] = backdrop;
+
+      return;
+    }
+
+    BYTE* background = background_line + scroll->fine_x;
+
+    if (mask->get_flag(NES_PPU_Mask_Register::flag::SB))
+      render_background();
+    else
+      memset(background_line, 0, sizeof(background_line));
+
+    if (!mask->get_flag(NES_PPU_Mask_Register::flag::LB))
+      memset(background, 0, 8);
+
+    render_sprites();
+
+    NES_PPU_Line_Kernel::line inputs = { background, sprite_line, sprite_behind, palette_table, grayscale, emphasis, line };
+    compose(inputs);
+  }
+
+  void NES_PPU::render_background() {
+    /**
+     * Copies the 33 tiles the line can touch out of the background layer,
+     * from the nametable v points into and the one to its right.
+     */
+    address_t v = addr->get();
+    unsigned int coarse_x = v & 0x001F;
+    unsigned int coarse_y = (v >> 5) & 0x001F;
+
+    // Rows 30 and 31 fetch attribute bytes as tiles, the layer only has 0-29.
+    if (coarse_y >= 30) {
+      fetch_background(v);
+      return;
+    }
+
+    if (patterns_dirty)
+      apply_dirty_patterns();
+
+    unsigned int y = coarse_y * 8 + ((v >> 12) & 0x07);
+    unsigned int left = physical_nametable((v >> 10) & 0x03);
+    unsigned int right = physical_nametable(((v >> 10) & 0x03) ^ 0x01);
+    unsigned int left_tiles = 32 - coarse_x;
+
+    for (unsigned int x = coarse_x; x < 32; x++)
+      refresh_background_tile(left, coarse_y * 32 + x);
+
+    for (unsigned int x = 0; x <= coarse_x; x++)
+      refresh_background_tile(right, coarse_y * 32 + x);
+
+    memcpy(background_line, &background_plane[left * NAMETABLE_PIXELS + y * 256 + coarse_x * 8], left_tiles * 8);
+    memcpy(background_line + left_tiles * 8, &background_plane[right * NAMETABLE_PIXELS + y * 256], (coarse_x + 1) * 8);
   }
 
-  void NES_PPU::render(NES_Frame &frame) {
-    // Render background
+  void NES_PPU::fetch_background(address_t v) {
+    // Tile by tile from the nametables, for lines the background layer does not cover.
     address_t bank = control->get_background_pattern_addr();
+    BYTE fine_y = (v >> 12) & 0x07;
 
-    for (int i = 0; i < 0x03C0; i++) {
-      address_t tile = vram[i];
-      BYTE tile_x = tile % 32;
-      BYTE tile_y = tile / 32;
-      std::vector<uint8_t> palette = background_palette(tile_x, tile_y);
-      
-      for (int y = 0; y <= 7; y++) {
-        BYTE upper = cartridge->read_chr_memory(y + (bank + tile * 16));
-        BYTE lower = cartridge->read_chr_memory(y + 8 + (bank + tile * 16));
-
-        for (int x = 7; x >= 0; x--) {
-          BYTE val = (1 & upper) << 1 | (1 & lower);
-          upper >>= 1;
-          lower >>= 1;
-          std::vector<uint8_t> rgb = SYSTEM_PALETTE[palette[val]];
-          frame.set_pixel(tile_x * 8 + x, tile_y * 8 + y, rgb[0], rgb[1], rgb[2]);
-        }
+    for (int tile = 0; tile < 33; tile++) {
+      BYTE index = read_vram(0x2000 | (v & 0x0FFF));
+      BYTE attribute = read_vram(0x23C0 | (v & 0x0C00) | ((v >> 4) & 0x38) | ((v >> 2) & 0x07));
+      BYTE palette = (attribute >> (((v >> 4) & 0x04) | (v & 0x02))) & 0x03;
+
+      // The palette goes on every opaque pixel, eight at once: each pixel is
+      // 0-3, so bits 0 and 1 of a byte never carry into the next one.
+      uint64_t pixels;
+      memcpy(&pixels, cartridge->get_tile(chr_offset(bank + index * 16), false) + fine_y * 8, 8);
+      pixels |= ((pixels | (pixels >> 1)) & 0x0101010101010101ull) * (palette << 2);
+      memcpy(background_line + tile * 8, &pixels, 8);
+
+      // Coarse X, wrapping into the horizontally adjacent nametable
+      if ((v & 0x001F) == 31) {
+        v &= ~0x001F;
+        v ^= 0x0400;
+      } else {
+        v++;
+      }
+    }
+  }
+
+  unsigned int NES_PPU::physical_nametable(unsigned int nametable) {
+    return (pages[8 + nametable].memory - vram) >> 10;
+  }
+
+  void NES_PPU::invalidate_background() {
+    std::fill(background_dirty.begin(), background_dirty.end(), 1);
+    memset(dirty_patterns, 0, sizeof(dirty_patterns));
+    patterns_dirty = false;
+  }
+
+  void NES_PPU::mark_background_dirty(address_t address) {
+    unsigned int plane = physical_nametable((address >> 10) & 0x03);
+    unsigned int offset = address & 0x03FF;
+    BYTE* dirty = &background_dirty[plane * NAMETABLE_TILES];
+
+    if (offset < NAMETABLE_TILES) {
+      dirty[offset] = 1;
+      return;
+    }
+
+    // An attribute byte covers a 4x4 block of tiles, the last row of blocks is cut short.
+    unsigned int block_x = (offset & 0x07) * 4;
+    unsigned int block_y = ((offset - NAMETABLE_TILES) >> 3) * 4;
+
+    for (unsigned int y = block_y; y < block_y + 4 && y < 30; y++)
+      memset(dirty + y * 32 + block_x, 1, 4);
+  }
+
+  void NES_PPU::apply_dirty_patterns() {
+    // Tiles showing a pattern that was written to since the last check are redrawn.
+    for (size_t plane = 0; plane < background_dirty.size() / NAMETABLE_TILES; plane++) {
+      const BYTE* nametable = vram + plane * 0x0400;
+      BYTE* dirty = &background_dirty[plane * NAMETABLE_TILES];
+
+      for (unsigned int tile = 0; tile < NAMETABLE_TILES; tile++)
+        dirty[tile] |= dirty_patterns[nametable[tile]];
+    }
+
+    memset(dirty_patterns, 0, sizeof(dirty_patterns));
+    patterns_dirty = false;
+  }
+
+  void NES_PPU::refresh_background_tile(unsigned int plane, unsigned int tile) {
+    BYTE &dirty = background_dirty[plane * NAMETABLE_TILES + tile];
+
+    if (!dirty)
+      return;
+
+    const BYTE* nametable = vram + plane * 0x0400;
+    unsigned int x = tile & 0x1F;
+    unsigned int y = tile >> 5;
+
+    BYTE attribute = nametable[NAMETABLE_TILES + (y >> 2) * 8 + (x >> 2)];
+    BYTE palette = (attribute >> (((y & 0x02) << 1) | (x & 0x02))) & 0x03;
+    const BYTE* pixels = cartridge->get_tile(chr_offset(background_bank + nametable[tile] * 16), false);
+    BYTE* row = &background_plane[plane * NAMETABLE_PIXELS + y * 8 * 256 + x * 8];
+
+    for (int line = 0; line < 8; line++) {
+      uint64_t colors;
+      memcpy(&colors, pixels + line * 8, 8);
+      colors |= ((colors | (colors >> 1)) & 0x0101010101010101ull) * (palette << 2);
+      memcpy(row + line * 256, &colors, 8);
+    }
+
+    dirty = 0;
+  }
+
+  void NES_PPU::evaluate_sprites() {
+    // The first eight sprites in OAM order that cover the line, a ninth sets overflow.
+    int height = control->get_flag(NES_PPU_Control_Register::flag::SSZ) ? 16 : 8;
+    line_sprite_count = 0;
+
+    for (int i = 0; i < 64; i++) {
+      int row = (int)scanline - (oam_data[i * 4] + 1);
+
+      if (row < 0 || row >= height)
+        continue;
+
+      if (line_sprite_count == SPRITES_PER_LINE) {
+        status->set_flag(NES_PPU_Status_Register::flag::SOF);
+        break;
       }
+
+      line_sprites[line_sprite_count++] = i;
     }
+  }
+
+  void NES_PPU::render_sprites() {
+    memset(sprite_line, 0, sizeof(sprite_line));
+    memset(sprite_behind, 0, sizeof(sprite_behind));
+
+    evaluate_sprites();
+
+    if (!mask->get_flag(NES_PPU_Mask_Register::flag::SS))
+      return;
+
+    int height = control->get_flag(NES_PPU_Control_Register::flag::SSZ) ? 16 : 8;
+
+    /**
+     * Sprites are drawn back to front, eight pixels at a time through byte
+     * masks, so the lowest OAM index ends up on top wherever it is opaque.
+     */
+    for (int n = line_sprite_count - 1; n >= 0; n--) {
+      const BYTE* sprite = oam_data + line_sprites[n] * 4;
+      BYTE tile = sprite[1];
+      BYTE attributes = sprite[2];
+
+      // Sprites are drawn one line below their OAM Y.
+      int row = (int)scanline - (sprite[0] + 1);
 
-    // Render sprites
-    for (int i = 252; i >= 0; i--) {
-      address_t tile = oam_data[i + 1];
-      BYTE tile_x = oam_data[i + 3];
-      BYTE tile_y = oam_data[i];
+      if (attributes & 0x80)
+        row = height - 1 - row;
 
-      bool flip_vertical = (oam_data[i + 2] >> 7) & 1;
-      bool flip_horizontal = (oam_data[i + 2] >> 6) & 1;
-      BYTE flip = (oam_data[i + 2] >> 6) & 0b11;
+      const BYTE* pixels = cartridge->get_tile(chr_offset(sprite_pattern(tile, row)), attributes & 0x40) + (row & 0x07) * 8;
+      uint64_t colors;
+      memcpy(&colors, pixels, 8);
 
-      BYTE palette_idx = oam_data[i + 2] & 0b11;
-      std::vector<uint8_t> palette = sprite_palette(palette_idx);
+      uint64_t opaque = ((colors | (colors >> 1)) & 0x0101010101010101ull) * 0xFF;
+      uint64_t behind = (attributes & 0x20) ? opaque : 0;
+      colors |= (0x10 | ((attributes & 0x03) << 2)) * 0x0101010101010101ull;
 
-      bank = control->get_sprite_pattern_addr();
+      uint64_t line, priority;
+      memcpy(&line, sprite_line + sprite[3], 8);
+      memcpy(&priority, sprite_behind + sprite[3], 8);
 
-      for (int y = 0; y <= 7; y++) {
-        BYTE upper = cartridge->read_chr_memory(y + (bank + tile * 16));
-        BYTE lower = cartridge->read_chr_memory(y + 8 + (bank + tile * 16));
+      line = (line & ~opaque) | (colors & opaque);
+      priority = (priority & ~opaque) | behind;
 
-        for (int x = 7; x >= 0; x--) {
-          BYTE val = (1 & upper) << 1 | (1 & lower);
-          upper >>= 1;
-          lower >>= 1;
+      memcpy(sprite_line + sprite[3], &line, 8);
+      memcpy(sprite_behind + sprite[3], &priority, 8);
+    }
+
+    if (!mask->get_flag(NES_PPU_Mask_Register::flag::LS))
+      memset(sprite_line, 0, 8);
+  }
+
+  address_t NES_PPU::sprite_pattern(BYTE tile, int row) {
+    // 8x16 sprites pick their pattern table with bit 0 of the tile number.
+    if (control->get_flag(NES_PPU_Control_Register::flag::SSZ))
+      return ((tile & 1) ? 0x1000 : 0) + (tile & 0xFE) * 16 + (row & 0x08 ? 16 : 0);
+
+    return control->get_sprite_pattern_addr() + tile * 16;
+  }
 
-          if (val == 0)
+  bool NES_PPU::background_opaque(address_t v, unsigned int x) {
+    // Background pixel at screen X of the line v is set up for.
+    unsigned int column = scroll->fine_x + x;
+    unsigned int coarse_x = (v & 0x001F) + column / 8;
+
+    if (coarse_x >= 32) {
+      coarse_x -= 32;
+      v ^= 0x0400;
+    }
+
+    v = (v & ~0x001F) | coarse_x;
+
+    BYTE index = read_vram(0x2000 | (v & 0x0FFF));
+    const BYTE* tile = cartridge->get_tile(chr_offset(control->get_background_pattern_addr() + index * 16), false);
+
+    return tile[((v >> 12) & 0x07) * 8 + column % 8] != 0;
+  }
+
+  master_cycle_t NES_PPU::predict_sprite_zero_hit() {
+    /**
+     * Walks the scroll forward from the current position as the renderer
+     * will, assuming nothing changes, and tests the pixels sprite 0 covers.
+     * Any write that could change the answer makes the prediction stale.
+     */
+    if (!cartridge || !mask->get_flag(NES_PPU_Mask_Register::flag::SB) || !mask->get_flag(NES_PPU_Mask_Register::flag::SS))
+      return NO_SPRITE_ZERO_HIT;
+
+    master_cycle_t frame_start = frame * DOTS_PER_FRAME;
+    address_t v = addr->get();
+    unsigned int line = scanline;
+    unsigned int first_dot = dot;
+
+    if (scanline < VISIBLE_SCANLINES) {
+      // The flag is only set once per frame.
+      if (status->get_flag(NES_PPU_Status_Register::flag::SZH))
+        return NO_SPRITE_ZERO_HIT;
+
+      // Past the end of the line, v is already set up for the next one.
+      if (dot >= LINE_END_DOT) {
+        line++;
+        first_dot = 0;
+      }
+    } else {
+      // Next frame, from the scroll the pre-render line will load.
+      frame_start += DOTS_PER_FRAME;
+      line = 0;
+      first_dot = 0;
+
+      if (scanline != PRE_RENDER_SCANLINE || dot < LINE_END_DOT)
+        v = copy_scroll_y(copy_scroll_x(increment_scroll_y(v)));
+    }
+
+    int height = control->get_flag(NES_PPU_Control_Register::flag::SSZ) ? 16 : 8;
+    bool left_clip = !mask->get_flag(NES_PPU_Mask_Register::flag::LB) || !mask->get_flag(NES_PPU_Mask_Register::flag::LS);
+    BYTE attributes = oam_data[2];
+    unsigned int top = oam_data[0] + 1;
+
+    for (; line < VISIBLE_SCANLINES && line < top + height; line++) {
+      if (line >= top) {
+        int row = line - top;
+
+        if (attributes & 0x80)
+          row = height - 1 - row;
+
+        const BYTE* pixels = cartridge->get_tile(chr_offset(sprite_pattern(oam_data[1], row)), attributes & 0x40) + (row & 0x07) * 8;
+
+        for (unsigned int i = 0; i < 8; i++) {
+          unsigned int x = oam_data[3] + i;
+
+          // No hit at X 255, in a clipped left column, or at a dot already passed.
+          // A hit at the current dot is still due, its event may be the one asking.
+          if (x == 255)
+            break;
+
+          if (!pixels[i] || (x < 8 && left_clip) || x + 1 < first_dot)
             continue;
-          
-          std::vector<uint8_t> rgb = SYSTEM_PALETTE[palette[val]];
-
-          switch (flip) {
-            case 0:
-              frame.set_pixel(tile_x + x, tile_y + y, rgb[0], rgb[1], rgb[2]);
-              break;
-            case 1:
-              frame.set_pixel(tile_x + 7 - x, tile_y + y, rgb[0], rgb[1], rgb[2]);
-              break;
-            case 2:
-              frame.set_pixel(tile_x + x, tile_y + 7 - y, rgb[0], rgb[1], rgb[2]);
-              break;
-            case 3:
-              frame.set_pixel(tile_x + 7 - x, tile_y + 7 - y, rgb[0], rgb[1], rgb[2]);
-              break;
-          }
+
+          if (background_opaque(v, x))
+            return frame_start + line * DOTS_PER_SCANLINE + x + 1;
         }
       }
+
+      v = copy_scroll_x(increment_scroll_y(v));
+      first_dot = 0;
     }
+
+    return NO_SPRITE_ZERO_HIT;
+  }
+
+  void NES_PPU::run(master_cycle_t dots) {
+    /**
+     * Walks forward a line segment at a time, stopping at the end of the
+     * visible part of each line to draw it with the scroll and bank state
+     * current at that moment.
+     */
+    while (dots > 0) {
+      unsigned int stop = dot < LINE_END_DOT ? LINE_END_DOT : DOTS_PER_SCANLINE;
+      master_cycle_t step = std::min<master_cycle_t>(dots, stop - dot);
+
+      dot += step;
+      dots -= step;
+
+      if (dot == LINE_END_DOT)
+        end_scanline();
+
+      if (dot == DOTS_PER_SCANLINE) {
+        dot = 0;
+
+        if (++scanline == SCANLINES_PER_FRAME) {
+          scanline = 0;
+          frame++;
+        }
+      }
+    }
+  }
+
+  master_cycle_t NES_PPU::get_position() {
+    return frame * DOTS_PER_FRAME + scanline * DOTS_PER_SCANLINE + dot;
+  }
+
+  unsigned int NES_PPU::get_dot() {
+    return dot;
+  }
+
+  unsigned int NES_PPU::get_scanline() {
+    return scanline;
+  }
+
+  uint64_t NES_PPU::get_frame() {
+    return frame;
+  }
+
+  void NES_PPU::serialize(NES_State &state) {
+    state.value(dot);
+    state.value(scanline);
+    state.value(frame);
+
+    // Only the nametables the board has, the upper 2KB is there for four-screen carts.
+    state.bytes(palette_table, sizeof(palette_table));
+    state.bytes(vram, background_dirty.size() / NAMETABLE_TILES * 0x0400);
+    state.bytes(oam_data, sizeof(oam_data));
+    state.value(oam_address);
+    state.value(internal_buf);
+
+    BYTE control_value = control->get();
+    BYTE mask_value = mask->get();
+    BYTE status_value = status->get();
+
+    state.value(control_value);
+    state.value(mask_value);
+    state.value(status_value);
+    scroll->serialize(state);
+    addr->serialize(state);
+
+    if (!state.is_loading())
+      return;
+
+    control->set(control_value);
+    write_to_mask(mask_value);
+    status->set(status_value);
+
+    // Everything derived from the registers and memory is rebuilt.
+    background_bank = control->get_background_pattern_addr();
+
+    if (cartridge) {
+      map_chr();
+      map_nametables(cartridge->get_mirror_mode());
+    }
+
+    invalidate_background();
+    line_sprite_count = 0;
+    sprite_zero_hit_stale = true;
   }
 }
@@ -3,17 +3,61 @@
 #include "nes_ppu_address_register.h"
 #include "nes_ppu_control_register.h"
 #include "nes_frame.h"
-#include "nes_palette.h"
 #include "nes_ppu_mask_register.h"
 #include "nes_ppu_scroll_register.h"
 #include "nes_ppu_status_register.h"
+#include "nes_ppu_line_kernel.h"
 
 namespace NES_Emulator {
   class NES_PPU {
+    public:
+      // Frame timing, in dots
+      static const unsigned int DOTS_PER_SCANLINE = 341;
+      static const unsigned int SCANLINES_PER_FRAME = 262;
+      static const unsigned int DOTS_PER_FRAME = DOTS_PER_SCANLINE * SCANLINES_PER_FRAME;
+
+      // Scanlines
+      static const unsigned int VISIBLE_SCANLINES = 240;
+      static const unsigned int PRE_RENDER_SCANLINE = 261;
+
+      // Dot after the last visible pixel, where a line is drawn and the scroll moves on
+      static const unsigned int LINE_END_DOT = 257;
+
+      // Sprites drawn on one scanline
+      static const unsigned int SPRITES_PER_LINE = 8;
+
+      // Nametable layout
+      static const unsigned int NAMETABLE_TILES = 32 * 30;
+      static const unsigned int NAMETABLE_PIXELS = 256 * 240;
+
+      // Sprite 0 hit time when none is coming
+      static const master_cycle_t NO_SPRITE_ZERO_HIT = UINT64_MAX;
+
+      // Mapper scanline clock time when rendering is off
+      static const master_cycle_t NO_SCANLINE_CLOCK = UINT64_MAX;
+
     private:
+      // Position
+      unsigned int dot;
+      unsigned int scanline;
+      uint64_t frame;
+
       // Memory
       BYTE palette_table[32];
-      BYTE vram[0xFFFF];
+      BYTE vram[0x1000];
+
+      // Memory map, one entry per 1KB page of $0000-$3FFF. Pattern table pages
+      // also keep their CHR offset, which the tile cache is keyed by.
+      struct memory_page {
+        const BYTE* memory;
+        uint32_t chr_offset;
+      };
+
+      memory_page pages[16];
+
+      // Mapping state the pages were built from
+      mirror_mode mirror;
+      unsigned int mapped_chr_generation;
       BYTE oam_data[256];
 
       // Registers
@@ -27,14 +71,88 @@ namespace NES_Emulator {
       // Internal Buffer
       BYTE internal_buf;
 
+      // Output
+      NES_Frame* screen;
+
+      // Frames drawn, every Nth frame or none when 0
+      unsigned int render_interval;
+
+      // Emphasis bits, in NES_Frame pixel position, and the palette value
+      // mask for grayscale
+      uint16_t emphasis;
+      BYTE grayscale;
+
+      // Line buffers, palette RAM indexes for one scanline. Both have room
+      // for a tile past the right edge, from fine X scroll or a sprite at X > 248.
+      BYTE background_line[256 + 8];
+      BYTE sprite_line[256 + 8];
+      BYTE sprite_behind[256 + 8];
+
+      // OAM indexes of the sprites on the current scanline, in priority order
+      BYTE line_sprites[SPRITES_PER_LINE];
+      unsigned int line_sprite_count;
+
+      // Background layer: every physical nametable decoded to palette RAM
+      // indexes, refreshed a tile at a time when a line needs a dirty one
+      std::vector<BYTE> background_plane;
+      std::vector<BYTE> background_dirty;
+      address_t background_bank;
+
+      // Background pattern tiles written since the layer was last checked
+      BYTE dirty_patterns[256];
+      bool patterns_dirty;
+
+      // Predicted sprite 0 hit, recomputed after anything that can move it
+      master_cycle_t sprite_zero_hit_time;
+      bool sprite_zero_hit_stale;
+
+      // Composes the line buffers into a frame row
+      NES_PPU_Line_Kernel::kernel compose;
+
       // Cartridge
       NES_Cartridge* cartridge;
 
       // VRAM Helpers
-      address_t mirror_vram_addr(address_t);
+      void map_chr();
+      void map_nametables(mirror_mode);
+      BYTE read_vram(address_t);
+      uint32_t chr_offset(address_t);
+      BYTE read_palette(BYTE);
+      void write_palette(BYTE, BYTE);
+
+      // Scroll Helpers, on a VRAM address
+      bool rendering_enabled();
+      address_t increment_scroll_y(address_t);
+      address_t copy_scroll_x(address_t);
+      address_t copy_scroll_y(address_t);
+
+      // Render Helpers
+      void end_scanline();
+      void render_scanline();
+      void render_background();
+      void fetch_background(address_t);
+      void evaluate_sprites();
+
+      // Background Layer Helpers
+      unsigned int physical_nametable(unsigned int);
+      void invalidate_background();
+      void mark_background_dirty(address_t);
+      void apply_dirty_patterns();
+      void refresh_background_tile(unsigned int, unsigned int);
+      void render_sprites();
+
+      // Sprite Helpers
+      address_t sprite_pattern(BYTE, int);
+      bool background_opaque(address_t, unsigned int);
+      master_cycle_t predict_sprite_zero_hit();
 
     public:
       NES_PPU();
+      ~NES_PPU();
+
+      // Owns its registers and frame
+      NES_PPU(const NES_PPU&) = delete;
+      NES_PPU &operator=(const NES_PPU&) = delete;
 
       // Read
       BYTE read();
@@ -51,6 +169,18 @@ namespace NES_Emulator {
       // Status register
       BYTE read_status();
 
+      // Timing events
+      bool start_vblank();
+      void end_vblank();
+      void set_sprite_zero_hit();
+
+      // Dot the sprite 0 hit flag is next set at, NO_SPRITE_ZERO_HIT when none
+      // is coming this frame or the next
+      master_cycle_t get_sprite_zero_hit();
+
+      // Dot of the Nth mapper scanline clock from now, assuming rendering stays on
+      master_cycle_t get_scanline_clock(unsigned int);
+
       // OAM
       BYTE read_oam_data();
       void write_to_oam_addr(BYTE);
@@ -65,13 +195,21 @@ namespace NES_Emulator {
 
       // Cartridge
       void insert_cartridge(NES_Cartridge*);
-
-      // Palette
-      std::vector<uint8_t> background_palette(BYTE, BYTE);
-      std::vector<uint8_t> sprite_palette(BYTE);
+      void update_banks();
 
       // Render
-      void render(NES_Frame&);
-
+      NES_Frame* get_screen();
+      void set_render_interval(unsigned int);
+      bool is_frame_rendered(uint64_t);
+
+      // Timing
+      void run(master_cycle_t);
+      master_cycle_t get_position();
+      unsigned int get_dot();
+      unsigned int get_scanline();
+      uint64_t get_frame();
+
+      // Save states, after the cartridge so the pages follow its restored banks
+      void serialize(NES_State&);
   };
 }
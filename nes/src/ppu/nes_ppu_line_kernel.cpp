@@ -0,0 +1,114 @@
+#include "nes_ppu_line_kernel.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define NES_PPU_LINE_KERNEL_X86
+#endif
+
+namespace NES_Emulator {
+  void NES_PPU_Line_Kernel::compose_scalar(const line &l) {
+    for (int x = 0; x < 256; x++) {
+      BYTE background = l.background[x];
+      BYTE sprite = l.sprite[x];
+
+      // Opaque sprite pixels win unless they are behind an opaque background pixel.
+      BYTE index = sprite && (!background || !l.sprite_behind[x]) ? sprite : background;
+      l.output[x] = l.emphasis | (l.palette_table[index] & l.grayscale);
+    }
+  }
+
+#ifdef NES_PPU_LINE_KERNEL_X86
+  __attribute__((target("sse4.1")))
+  void NES_PPU_Line_Kernel::compose_sse41(const line &l) {
+    /**
+     * 16 pixels at a time. Palette RAM fits in two 16 byte shuffle tables,
+     * picked between by bit 4 of the index.
+     */
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i high_half = _mm_set1_epi8(0x10);
+    const __m128i palette_lo = _mm_loadu_si128((const __m128i*)l.palette_table);
+    const __m128i palette_hi = _mm_loadu_si128((const __m128i*)(l.palette_table + 16));
+    const __m128i grayscale = _mm_set1_epi8(l.grayscale);
+    const __m128i emphasis = _mm_set1_epi16(l.emphasis);
+
+    for (int x = 0; x < 256; x += 16) {
+      __m128i background = _mm_loadu_si128((const __m128i*)(l.background + x));
+      __m128i sprite = _mm_loadu_si128((const __m128i*)(l.sprite + x));
+      __m128i behind = _mm_loadu_si128((const __m128i*)(l.sprite_behind + x));
+
+      __m128i sprite_clear = _mm_cmpeq_epi8(sprite, zero);
+      __m128i background_clear = _mm_cmpeq_epi8(background, zero);
+      __m128i in_front = _mm_cmpeq_epi8(behind, zero);
+      __m128i use_sprite = _mm_andnot_si128(sprite_clear, _mm_or_si128(background_clear, in_front));
+      __m128i index = _mm_blendv_epi8(background, sprite, use_sprite);
+
+      __m128i upper = _mm_cmpeq_epi8(_mm_and_si128(index, high_half), high_half);
+      __m128i color = _mm_blendv_epi8(_mm_shuffle_epi8(palette_lo, index), _mm_shuffle_epi8(palette_hi, index), upper);
+      color = _mm_and_si128(color, grayscale);
+
+      _mm_storeu_si128((__m128i*)(l.output + x), _mm_or_si128(_mm_unpacklo_epi8(color, zero), emphasis));
+      _mm_storeu_si128((__m128i*)(l.output + x + 8), _mm_or_si128(_mm_unpackhi_epi8(color, zero), emphasis));
+    }
+  }
+
+  __attribute__((target("avx2")))
+  void NES_PPU_Line_Kernel::compose_avx2(const line &l) {
+    // As compose_sse41, 32 pixels at a time. Shuffles stay within 128 bit lanes,
+    // so each lane gets its own copy of the tables.
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i high_half = _mm256_set1_epi8(0x10);
+    const __m256i palette_lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)l.palette_table));
+    const __m256i palette_hi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(l.palette_table + 16)));
+    const __m256i grayscale = _mm256_set1_epi8(l.grayscale);
+    const __m256i emphasis = _mm256_set1_epi16(l.emphasis);
+
+    for (int x = 0; x < 256; x += 32) {
+      __m256i background = _mm256_loadu_si256((const __m256i*)(l.background + x));
+      __m256i sprite = _mm256_loadu_si256((const __m256i*)(l.sprite + x));
+      __m256i behind = _mm256_loadu_si256((const __m256i*)(l.sprite_behind + x));
+
+      __m256i sprite_clear = _mm256_cmpeq_epi8(sprite, zero);
+      __m256i background_clear = _mm256_cmpeq_epi8(background, zero);
+      __m256i in_front = _mm256_cmpeq_epi8(behind, zero);
+      __m256i use_sprite = _mm256_andnot_si256(sprite_clear, _mm256_or_si256(background_clear, in_front));
+      __m256i index = _mm256_blendv_epi8(background, sprite, use_sprite);
+
+      __m256i upper = _mm256_cmpeq_epi8(_mm256_and_si256(index, high_half), high_half);
+      __m256i color = _mm256_blendv_epi8(_mm256_shuffle_epi8(palette_lo, index), _mm256_shuffle_epi8(palette_hi, index), upper);
+      color = _mm256_and_si256(color, grayscale);
+
+      // Widen each half in order, unpack would interleave the lanes.
+      __m256i first = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(color));
+      __m256i second = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(color, 1));
+
+      _mm256_storeu_si256((__m256i*)(l.output + x), _mm256_or_si256(first, emphasis));
+      _mm256_storeu_si256((__m256i*)(l.output + x + 16), _mm256_or_si256(second, emphasis));
+    }
+  }
+#endif
+
+  NES_PPU_Line_Kernel::kernel NES_PPU_Line_Kernel::get(instruction_set set) {
+    switch (set) {
+      case instruction_set::scalar:
+        return &compose_scalar;
+#ifdef NES_PPU_LINE_KERNEL_X86
+      case instruction_set::sse41:
+        return __builtin_cpu_supports("sse4.1") ? &compose_sse41 : nullptr;
+      case instruction_set::avx2:
+        return __builtin_cpu_supports("avx2") ? &compose_avx2 : nullptr;
+#endif
+      default:
+        return nullptr;
+    }
+  }
+
+  NES_PPU_Line_Kernel::kernel NES_PPU_Line_Kernel::select() {
+    if (kernel avx2 = get(instruction_set::avx2))
+      return avx2;
+
+    if (kernel sse41 = get(instruction_set::sse41))
+      return sse41;
+
+    return &compose_scalar;
+  }
+}
@@ -0,0 +1,39 @@
+#include "nes.h"
+
+namespace NES_Emulator {
+  class NES_PPU_Line_Kernel {
+  public:
+    // One scanline's worth of inputs, 256 entries each
+    struct line {
+      const BYTE* background;    // Palette RAM indexes, fine X already applied, 0 when transparent
+      const BYTE* sprite;        // Palette RAM indexes, 0 when transparent
+      const BYTE* sprite_behind; // Non-zero where the sprite pixel is behind the background
+      const BYTE* palette_table; // The 32 bytes of palette RAM
+      BYTE grayscale;            // Palette value mask
+      uint16_t emphasis;         // Emphasis bits, in NES_Frame pixel position
+      uint16_t* output;          // NES_Frame row
+    };
+
+    typedef void (*kernel)(const line&);
+
+    // Instruction sets with a kernel of their own
+    enum class instruction_set {
+      scalar,
+      sse41,
+      avx2
+    };
+
+  private:
+    // Kernels
+    static void compose_scalar(const line&);
+    static void compose_sse41(const line&);
+    static void compose_avx2(const line&);
+
+  public:
+    // Kernel for an instruction set, nullptr when the host does not support it
+    static kernel get(instruction_set);
+
+    // Fastest kernel the host supports
+    static kernel select();
+  };
+}
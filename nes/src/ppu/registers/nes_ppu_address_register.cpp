@@ -44,4 +44,10 @@ namespace NES_Emulator {
   void NES_PPU_Address_Register::reset_latch() {
     hi_ptr = true;
   }
+
+  void NES_PPU_Address_Register::serialize(NES_State &state) {
+    state.value(address);
+    state.value(data);
+    state.value(hi_ptr);
+  }
 }
@@ -1,4 +1,5 @@
 #include "nes.h"
+#include "nes_state.h"
 
 namespace NES_Emulator {
   class NES_PPU_Address_Register {
@@ -23,5 +24,8 @@ namespace NES_Emulator {
 
     // Flag functions
     void reset_latch();
+
+    // Save states
+    void serialize(NES_State&);
   };
 }
\ No newline at end of file
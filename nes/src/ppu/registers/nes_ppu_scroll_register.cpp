@@ -4,19 +4,56 @@ namespace NES_Emulator {
   NES_PPU_Scroll_Register::NES_PPU_Scroll_Register() {
     scroll_x = 0;
     scroll_y = 0;
+    temp = 0;
+    fine_x = 0;
     latch = false;
   }
 
   void NES_PPU_Scroll_Register::write(BYTE val) {
-    if (!latch)
+    if (!latch) {
       scroll_x = val;
-    else
+
+      // Coarse X into t, fine X kept separately.
+      temp = (temp & ~0x001F) | (val >> 3);
+      fine_x = val & 0x07;
+    } else {
       scroll_y = val;
+
+      // Fine Y and coarse Y into t.
+      temp = (temp & ~0x73E0) | ((val & 0x07) << 12) | ((val & 0xF8) << 2);
+    }
     
     latch = !latch;
   }
 
+  void NES_PPU_Scroll_Register::write_control(BYTE val) {
+    // Nametable select bits.
+    temp = (temp & ~0x0C00) | ((val & 0x03) << 10);
+  }
+
+  bool NES_PPU_Scroll_Register::write_address(BYTE val) {
+    /**
+     * $2006 shares t and the latch with $2005. Returns true once the second
+     * write has completed t, which the PPU then copies into the VRAM address.
+     */
+    if (!latch)
+      temp = (temp & 0x00FF) | ((val & 0x3F) << 8);
+    else
+      temp = (temp & 0xFF00) | val;
+
+    latch = !latch;
+    return !latch;
+  }
+
   void NES_PPU_Scroll_Register::reset_latch() {
     latch = false;
   }
+
+  void NES_PPU_Scroll_Register::serialize(NES_State &state) {
+    state.value(scroll_x);
+    state.value(scroll_y);
+    state.value(temp);
+    state.value(fine_x);
+    state.value(latch);
+  }
 }
@@ -1,4 +1,5 @@
 #include "nes.h"
+#include "nes_state.h"
 
 namespace NES_Emulator {
   class NES_PPU_Scroll_Register {
@@ -7,6 +8,10 @@ namespace NES_Emulator {
     BYTE scroll_x;
     BYTE scroll_y;
 
+    // Temporary VRAM address (t) and fine X scroll, shared with $2000 and $2006
+    address_t temp;
+    BYTE fine_x;
+
     // Latch
     bool latch;
 
@@ -14,9 +19,13 @@ namespace NES_Emulator {
 
     // Write
     void write(BYTE);
+    void write_control(BYTE);
+    bool write_address(BYTE);
 
     // Reset Latch
     void reset_latch();
 
+    // Save states
+    void serialize(NES_State&);
   };
 }
\ No newline at end of file
@@ -9,6 +9,10 @@ namespace NES_Emulator {
     status |= (BYTE)f;
   }
 
+  void NES_PPU_Status_Register::clear_flag(flag f) {
+    status &= ~(BYTE)f;
+  }
+
   bool NES_PPU_Status_Register::get_flag(flag f) {
     if (status & (BYTE)f)
       return 1;
@@ -23,6 +23,7 @@ namespace NES_Emulator {
 
     // Flags
     void set_flag(flag);
+    void clear_flag(flag);
     bool get_flag(flag);
     
     // Register
@@ -0,0 +1,225 @@
+#include "nes.h"
+#include "nes_cartridge.h"
+#include <cstdio>
+
+using namespace NES_Emulator;
+
+/**
+ * Decodes archaic iNES, iNES and NES 2.0 headers, including NES 2.0
+ * exponent-multiplier sizes and files shorter than their header says,
+ * and checks a ROM database entry overriding the header. The database
+ * is also written and read back on its own. Images are built in memory
+ * and written to scratch files, as the cartridge loads from a path.
+ * Exits with the number of failures.
+ */
+
+static int failures = 0;
+
+static void check(bool passed, const char* test, const char* what) {
+  if (!passed) {
+    printf("FAIL %s: %s\n", test, what);
+    failures++;
+  }
+}
+
+// Header, then body_size bytes of PRG and CHR, trainer first when there is one
+struct header_case {
+  const char* name;
+  BYTE header[16];
+  size_t body_size;
+  NES_Cartridge::rom_info expected;
+};
+
+static const header_case HEADER_CASES[] = {
+  { "archaic iNES",
+    { 'N', 'E', 'S', 0x1A, 1, 1, 0x41, 'D', 'i', 's', 'k', 'D', 'u', 'd', 'e', '!' }, 0x6000,
+    { 4, 0, VERTICAL, false, nes_region_ntsc, 0x4000, 0x2000, 0x2000, 0, 0, 0 } },
+  { "iNES",
+    { 'N', 'E', 'S', 0x1A, 2, 1, 0x1A, 0x40, 0x02, 0x01, 0, 0, 0, 0, 0, 0 }, 0xA000,
+    { 0x41, 0, FOUR_SCREEN, true, nes_region_pal, 0x8000, 0x2000, 0, 0x4000, 0, 0 } },
+  { "iNES trainer and CHR RAM",
+    { 'N', 'E', 'S', 0x1A, 1, 0, 0x24, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, 0x200 + 0x4000,
+    { 2, 0, HORIZONTAL, false, nes_region_ntsc, 0x4000, 0, 0x2000, 0, 0x2000, 0 } },
+  { "iNES cut short",
+    { 'N', 'E', 'S', 0x1A, 4, 1, 0x00, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, 0x4000,
+    { 0, 0, HORIZONTAL, false, nes_region_ntsc, 0, 0, 0x2000, 0, 0, 0 } },
+  { "NES 2.0",
+    { 'N', 'E', 'S', 0x1A, 2, 1, 0x31, 0x48, 0x51, 0x00, 0x70, 0x07, 0x03, 0, 0, 0 }, 0xA000,
+    { 0x143, 5, VERTICAL, false, nes_region_dendy, 0x8000, 0x2000, 0, 0x2000, 0x2000, 0 } },
+  { "NES 2.0 exponent-multiplier",
+    { 'N', 'E', 'S', 0x1A, (14 << 2) | 1, 13 << 2, 0x00, 0x08, 0x00, 0xFF, 0x07, 0x00, 0x00, 0, 0, 0 }, 0xE000,
+    { 0, 0, HORIZONTAL, false, nes_region_ntsc, 0xC000, 0x2000, 0x2000, 0, 0, 0 } },
+  { "NES 2.0 count high nibble",
+    { 'N', 'E', 'S', 0x1A, 0x00, 0x00, 0x00, 0x08, 0x00, 0x01, 0x00, 0x00, 0x00, 0, 0, 0 }, 0x400000,
+    { 0, 0, HORIZONTAL, false, nes_region_ntsc, 0x400000, 0, 0, 0, 0, 0 } },
+  { "NES 2.0 exponent past the file",
+    { 'N', 'E', 'S', 0x1A, 40 << 2, 0x00, 0x00, 0x08, 0x00, 0x0F, 0x00, 0x00, 0x00, 0, 0, 0 }, 0x4000,
+    { 0, 0, HORIZONTAL, false, nes_region_ntsc, 0, 0, 0, 0, 0, 0 } },
+};
+
+// Writes the image, the body filled from a seed so every fixture has its own CRC
+static std::string write_image(const char* name, const BYTE* header, size_t body_size, unsigned int seed, std::vector<BYTE> &body) {
+  body.resize(body_size);
+
+  for (size_t i = 0; i < body_size; i++)
+    body[i] = (i * 131 + seed * 17 + (i >> 8)) & 0xFF;
+
+  std::string path = std::string(name) + ".nes";
+  std::ofstream ofs(path, std::ofstream::binary);
+
+  ofs.write((const char*)header, 16);
+  ofs.write((const char*)body.data(), body.size());
+
+  return path;
+}
+
+static void check_info(const NES_Cartridge::rom_info &info, const NES_Cartridge::rom_info &expected, const char* test) {
+  check(info.mapper == expected.mapper, test, "mapper");
+  check(info.submapper == expected.submapper, test, "submapper");
+  check(info.mirror == expected.mirror, test, "mirroring");
+  check(info.battery == expected.battery, test, "battery");
+  check(info.region == expected.region, test, "region");
+  check(info.prg_rom_size == expected.prg_rom_size, test, "PRG ROM size");
+  check(info.chr_rom_size == expected.chr_rom_size, test, "CHR ROM size");
+  check(info.prg_ram_size == expected.prg_ram_size, test, "PRG RAM size");
+  check(info.prg_nvram_size == expected.prg_nvram_size, test, "PRG NVRAM size");
+  check(info.chr_ram_size == expected.chr_ram_size, test, "CHR RAM size");
+  check(info.chr_nvram_size == expected.chr_nvram_size, test, "CHR NVRAM size");
+}
+
+static void test_headers() {
+  for (unsigned int i = 0; i < sizeof(HEADER_CASES) / sizeof(HEADER_CASES[0]); i++) {
+    const header_case &test = HEADER_CASES[i];
+    std::vector<BYTE> body;
+    std::string path = write_image(("cartridge_test_header" + std::to_string(i)).c_str(), test.header, test.body_size, i, body);
+
+    {
+      NES_Cartridge cartridge(path, "cartridge_test.sav");
+      check_info(cartridge.get_info(), test.expected, test.name);
+
+      // PRG ROM starts after the trainer.
+      if (test.expected.prg_rom_size) {
+        size_t trainer = test.header[6] & 0x04 ? 0x200 : 0;
+        check(cartridge.read_prg_memory(0) == body[trainer] && cartridge.read_prg_memory(1) == body[trainer + 1], test.name, "PRG ROM offset");
+      }
+    }
+
+    std::remove(path.c_str());
+  }
+
+  NES_Save_File::flush_all();
+  std::remove("cartridge_test.sav");
+}
+
+static NES_ROM_Database::entry make_entry(uint32_t crc, uint16_t mapper, uint8_t mirror, uint8_t region) {
+  NES_ROM_Database::entry game;
+  memset(&game, 0, sizeof(game));
+
+  game.crc = crc;
+  game.prg_rom_size = 0x4000;
+  game.chr_rom_size = 0x2000;
+  game.mapper = mapper;
+  game.mirror = mirror;
+  game.region = region;
+  game.prg_ram_shift = 7;
+
+  return game;
+}
+
+static void test_database_override() {
+  const char* test = "database override";
+  const BYTE header[16] = { 'N', 'E', 'S', 0x1A, 1, 1, 0x00, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+  std::vector<BYTE> known_body;
+  std::vector<BYTE> broken_body;
+  std::string known = write_image("cartridge_test_known", header, 0x6000, 100, known_body);
+  std::string broken = write_image("cartridge_test_broken", header, 0x6000, 101, broken_body);
+
+  // A second board for the first dump, and an entry out of range for the second.
+  NES_ROM_Database::entry board = make_entry(NES_ROM_Pool::crc32(known_body.data(), known_body.size()), 1, ONE_SCREEN_HI, nes_region_pal);
+  board.submapper = 5;
+  board.flags = NES_ROM_Database::FLAG_BATTERY;
+  board.prg_ram_shift = 0;
+  board.prg_nvram_shift = 7;
+  board.chr_ram_shift = 6;
+
+  NES_ROM_Database::entry invalid = make_entry(NES_ROM_Pool::crc32(broken_body.data(), broken_body.size()), 1, ONE_SCREEN_HI + 1, nes_region_pal);
+
+  check(NES_ROM_Database::write("cartridge_test.db", { board, invalid }), test, "write");
+  check(NES_ROM_Database::open("cartridge_test.db"), test, "open");
+
+  {
+    NES_Cartridge cartridge(known, "cartridge_test.sav");
+    check_info(cartridge.get_info(), { 1, 5, ONE_SCREEN_HI, true, nes_region_pal, 0x4000, 0x2000, 0, 0x2000, 0x1000, 0 }, test);
+  }
+
+  {
+    NES_Cartridge cartridge(broken, "cartridge_test.sav");
+    check_info(cartridge.get_info(), { 0, 0, HORIZONTAL, false, nes_region_ntsc, 0x4000, 0x2000, 0x2000, 0, 0, 0 }, "database entry out of range");
+  }
+
+  NES_ROM_Database::close();
+  NES_Save_File::flush_all();
+
+  std::remove("cartridge_test.db");
+  std::remove("cartridge_test.sav");
+  std::remove(known.c_str());
+  std::remove(broken.c_str());
+}
+
+static void test_database_round_trip() {
+  const char* test = "database round trip";
+  std::vector<NES_ROM_Database::entry> games;
+
+  // CRCs that share their low bits, so most entries sit away from their home slot.
+  for (uint32_t i = 0; i < 64; i++) {
+    NES_ROM_Database::entry game = make_entry(0x1000 * i + (i & 0x03), i, i % 5, i % 4);
+    game.submapper = i & 0x0F;
+    game.flags = i & 1 ? NES_ROM_Database::FLAG_BATTERY : 0;
+    game.chr_nvram_shift = i % 15;
+    games.push_back(game);
+  }
+
+  games[10].region = nes_region_dendy + 1;
+
+  check(NES_ROM_Database::write("cartridge_test_round_trip.db", games), test, "write");
+  check(NES_ROM_Database::open("cartridge_test_round_trip.db"), test, "open");
+
+  for (size_t i = 0; i < games.size(); i++) {
+    NES_ROM_Database::entry found;
+    bool present = NES_ROM_Database::find(games[i].crc, found);
+
+    // Stored entries are marked used, everything else comes back as written.
+    NES_ROM_Database::entry expected = games[i];
+    expected.flags |= NES_ROM_Database::FLAG_USED;
+
+    if (i == 10)
+      check(!present, test, "entry out of range ignored");
+    else
+      check(present && memcmp(&found, &expected, sizeof(expected)) == 0, test, "entry read back");
+  }
+
+  NES_ROM_Database::entry missing;
+  check(!NES_ROM_Database::find(0xDEAD0001, missing), test, "unknown CRC");
+
+  // A file that is not a database is refused, the open one stays.
+  std::ofstream("cartridge_test_bad.db") << "not a database";
+  check(!NES_ROM_Database::open("cartridge_test_bad.db"), test, "bad file refused");
+  check(NES_ROM_Database::find(games[0].crc, missing), test, "still open after a bad file");
+
+  NES_ROM_Database::close();
+  check(!NES_ROM_Database::is_open() && !NES_ROM_Database::find(games[0].crc, missing), test, "closed");
+
+  std::remove("cartridge_test_round_trip.db");
+  std::remove("cartridge_test_bad.db");
+}
+
+int main() {
+  test_headers();
+  test_database_override();
+  test_database_round_trip();
+
+  if (!failures)
+    printf("All cartridge tests passed\n");
+
+  return failures;
+}
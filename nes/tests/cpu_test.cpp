@@ -0,0 +1,162 @@
+#include "nes.h"
+#include "nes_cpu.h"
+#include <cstdio>
+
+using namespace NES_Emulator;
+
+/**
+ * Runs the same PRG ROM on the table interpreter and on the JIT core (the
+ * block core where there is no JIT) and checks that registers, RAM and
+ * cycle counts match after every batch. The quirks kept from the original
+ * interpreter are checked on their own first, on both cores: ADC ignores
+ * the carry in, CMP sets V, and JSR pushes to zero page without the $0100
+ * stack base. Exits with the number of failures.
+ */
+
+static int failures = 0;
+
+static void check(bool passed, const char* test, const char* what) {
+  if (!passed) {
+    printf("FAIL %s: %s\n", test, what);
+    failures++;
+  }
+}
+
+// 16KB NROM image with CHR RAM, the program at $8000 and data from $9000
+static std::string write_rom(const char* name, const std::vector<BYTE> &program) {
+  std::vector<BYTE> prg(0x4000, 0xEA);
+
+  std::copy(program.begin(), program.end(), prg.begin());
+
+  for (int i = 0; i < 0x0200; i++)
+    prg[0x1000 + i] = i * 37;
+
+  // Reset vector, $FFFC mirrors $BFFC
+  prg[0x3FFC] = 0x00;
+  prg[0x3FFD] = 0x80;
+
+  const BYTE header[16] = { 'N', 'E', 'S', 0x1A, 1, 0 };
+  std::string path = std::string(name) + ".nes";
+  std::ofstream ofs(path, std::ofstream::binary);
+
+  ofs.write((const char*)header, sizeof(header));
+  ofs.write((const char*)prg.data(), prg.size());
+
+  return path;
+}
+
+struct cpu_run {
+  NES_Bus bus;
+  NES_Cartridge cartridge;
+  NES_CPU cpu;
+
+  cpu_run(const std::string &path, nes_cpu_core core) : cartridge(path), cpu(&bus, core) {
+    bus.insert_cartridge(&cartridge);
+
+    // RAM is not cleared at power on, both runs start from the same contents.
+    for (address_t address = 0; address < 0x0800; address++)
+      bus.cpu_write(address, 0x00);
+
+    cpu.reset();
+  }
+
+  bool same_registers(cpu_run &other) {
+    return cpu.A() == other.cpu.A() && cpu.X() == other.cpu.X() && cpu.Y() == other.cpu.Y() &&
+      cpu.P() == other.cpu.P() && cpu.SP() == other.cpu.SP() && cpu.PC() == other.cpu.PC();
+  }
+
+  bool same_ram(cpu_run &other) {
+    for (address_t address = 0; address < 0x0800; address++) {
+      if (bus.cpu_read(address) != other.bus.cpu_read(address))
+        return false;
+    }
+
+    return true;
+  }
+};
+
+static nes_cpu_core compiled_core() {
+  return NES_CPU_JIT::is_supported() ? nes_cpu_core_jit : nes_cpu_core_block;
+}
+
+static void test_quirks(nes_cpu_core core, const char* test) {
+  std::string path = write_rom("cpu_test_quirks", {
+    0x38,             // SEC
+    0xA9, 0x01,       // LDA #$01
+    0x69, 0x01,       // ADC #$01      A = $02, the carry in is ignored
+    0x85, 0x20,       // STA $20
+    0xA9, 0x70,       // LDA #$70
+    0xC9, 0x80,       // CMP #$80      N and V set, C clear
+    0x08,             // PHP
+    0x68,             // PLA
+    0x85, 0x21,       // STA $21
+    0x20, 0x14, 0x80, // JSR $8014     pushes $8014 to $00FD, SP counts up
+    0xEA, 0xEA,
+    0x4C, 0x14, 0x80, // JMP $8014
+  });
+
+  cpu_run run(path, core);
+  run.cpu.run(100);
+
+  check(run.bus.cpu_read(0x20) == 0x02, test, "ADC ignores the carry in");
+  check(run.bus.cpu_read(0x21) == 0xF0, test, "CMP sets V");
+  check(run.bus.cpu_read(0xFD) == 0x14 && run.bus.cpu_read(0xFE) == 0x80, test, "JSR pushes to zero page");
+  check(run.cpu.SP() == 0xFF, test, "JSR moves SP up");
+
+  std::remove(path.c_str());
+}
+
+static void test_cores_match() {
+  std::string path = write_rom("cpu_test_loop", {
+    0xA2, 0x00,       // LDX #$00
+    0xA0, 0x00,       // LDY #$00
+    0xBD, 0xF8, 0x90, // LDA $90F8,X   page crossed from X = 8
+    0x7D, 0x00, 0x03, // ADC $0300,X
+    0x9D, 0x00, 0x03, // STA $0300,X
+    0xC9, 0x40,       // CMP #$40
+    0x08,             // PHP
+    0x68,             // PLA
+    0x99, 0x00, 0x04, // STA $0400,Y
+    0x59, 0xF0, 0x90, // EOR $90F0,Y   page crossed from Y = 16
+    0x85, 0x10,       // STA $10
+    0xE6, 0x11,       // INC $11
+    0xC8,             // INY
+    0xE8,             // INX
+    0xD0, 0xE5,       // BNE $8004
+    0x20, 0x24, 0x80, // JSR $8024     walks SP up through zero page
+    0xEA, 0xEA,
+    0xA5, 0x10,       // LDA $10
+    0x4C, 0x04, 0x80, // JMP $8004
+  });
+
+  cpu_run table(path, nes_cpu_core_table);
+  cpu_run compiled(path, compiled_core());
+  uint64_t table_cycles = 0;
+  uint64_t compiled_cycles = 0;
+
+  // Odd batch sizes end batches in the middle of blocks.
+  for (int batch = 0; batch < 2000 && !failures; batch++) {
+    unsigned int budget = 1 + (batch * 37) % 211;
+
+    table_cycles += table.cpu.run(budget);
+    compiled_cycles += compiled.cpu.run(budget);
+
+    check(table_cycles == compiled_cycles, "cores match", "cycle count");
+    check(table.same_registers(compiled), "cores match", "registers");
+  }
+
+  check(table.same_ram(compiled), "cores match", "RAM");
+
+  std::remove(path.c_str());
+}
+
+int main() {
+  test_quirks(nes_cpu_core_table, "quirks, table core");
+  test_quirks(compiled_core(), "quirks, compiled core");
+  test_cores_match();
+
+  if (!failures)
+    printf("All CPU tests passed\n");
+
+  return failures;
+}
@@ -0,0 +1,216 @@
+#include "nes.h"
+#include "nes_mapper_mmc1.h"
+#include "nes_mapper_uxrom.h"
+#include "nes_mapper_cnrom.h"
+#include "nes_mapper_mmc3.h"
+#include <cstdio>
+
+using namespace NES_Emulator;
+
+/**
+ * Drives the mappers through their registers and checks the banks they
+ * map: the MMC1 serial port, PRG modes and SUROM outer bank, UxROM and
+ * CNROM bank selects, and the MMC3 scanline counter against the number
+ * of scanlines get_irq_scanlines() predicts. Exits with the number of
+ * failures.
+ */
+
+static int failures = 0;
+
+static void check(bool passed, const char* test, const char* what) {
+  if (!passed) {
+    printf("FAIL %s: %s\n", test, what);
+    failures++;
+  }
+}
+
+// Loads an MMC1 register through the serial port, low bit first
+static void mmc1_write(NES_Mapper &mapper, address_t address, BYTE val) {
+  for (int bit = 0; bit < 5; bit++)
+    mapper.cpu_write(address, (val >> bit) & 0x01);
+}
+
+static void test_mmc1_shift_register() {
+  const char* test = "MMC1 shift register";
+  NES_Mapper_MMC1 mapper(0x20000, 0x20000, HORIZONTAL);
+
+  // Powers up with the last bank fixed at $C000.
+  check(mapper.map_prg(0x8000) == 0x00000, test, "first bank at $8000 on power up");
+  check(mapper.map_prg(0xC000) == 0x1C000, test, "last bank at $C000 on power up");
+
+  // Nothing changes until the fifth write.
+  for (int bit = 0; bit < 4; bit++)
+    mapper.cpu_write(0xE000, 0x01);
+
+  check(mapper.map_prg(0x8000) == 0x00000, test, "four writes leave the bank");
+
+  mapper.cpu_write(0xFFFF, 0x00);
+  check(mapper.map_prg(0x8000) == 0x0F * 0x4000 % 0x20000, test, "fifth write loads the register");
+
+  // Bit 7 drops the bits shifted in so far.
+  mapper.cpu_write(0xE000, 0x01);
+  mapper.cpu_write(0xE000, 0x01);
+  mapper.cpu_write(0x8000, 0x80);
+  mmc1_write(mapper, 0xE000, 0x02);
+
+  check(mapper.map_prg(0x8000) == 0x08000, test, "reset restarts the sequence");
+  check(mapper.map_prg(0xC000) == 0x1C000, test, "reset fixes the last bank");
+}
+
+static void test_mmc1_prg_modes() {
+  const char* test = "MMC1 PRG modes";
+  NES_Mapper_MMC1 mapper(0x20000, 0x20000, HORIZONTAL);
+
+  mmc1_write(mapper, 0xE000, 0x05);
+
+  // 32KB, the low bit of the bank ignored
+  mmc1_write(mapper, 0x8000, 0x00);
+  check(mapper.map_prg(0x8000) == 0x10000 && mapper.map_prg(0xC000) == 0x14000, test, "32KB mode");
+  check(mapper.get_mirror_mode() == ONE_SCREEN_LO, test, "one screen mirroring");
+
+  // First bank fixed at $8000
+  mmc1_write(mapper, 0x8000, 0x0B);
+  check(mapper.map_prg(0x8000) == 0x00000 && mapper.map_prg(0xC000) == 0x14000, test, "first bank fixed");
+  check(mapper.get_mirror_mode() == HORIZONTAL, test, "horizontal mirroring");
+
+  // Last bank fixed at $C000
+  mmc1_write(mapper, 0x8000, 0x0E);
+  check(mapper.map_prg(0x8000) == 0x14000 && mapper.map_prg(0xC000) == 0x1C000, test, "last bank fixed");
+  check(mapper.get_mirror_mode() == VERTICAL, test, "vertical mirroring");
+
+  // CHR in one 8KB or two 4KB banks
+  mmc1_write(mapper, 0xA000, 0x03);
+  mmc1_write(mapper, 0xC000, 0x06);
+  check(mapper.map_chr(0x0000) == 0x2000 && mapper.map_chr(0x1000) == 0x3000, test, "8KB CHR");
+
+  mmc1_write(mapper, 0x8000, 0x1E);
+  check(mapper.map_chr(0x0000) == 0x3000 && mapper.map_chr(0x1000) == 0x6000, test, "4KB CHR");
+}
+
+static void test_mmc1_surom() {
+  const char* test = "MMC1 SUROM";
+  NES_Mapper_MMC1 mapper(0x80000, 0x2000, HORIZONTAL);
+
+  // The last bank fixed at $C000 is the last of the selected 256KB half.
+  mmc1_write(mapper, 0xE000, 0x02);
+  check(mapper.map_prg(0x8000) == 0x08000 && mapper.map_prg(0xC000) == 0x3C000, test, "first half");
+
+  mmc1_write(mapper, 0xA000, 0x10);
+  check(mapper.map_prg(0x8000) == 0x48000 && mapper.map_prg(0xC000) == 0x7C000, test, "second half");
+
+  // Every PRG mode takes the outer bank.
+  mmc1_write(mapper, 0x8000, 0x08);
+  check(mapper.map_prg(0x8000) == 0x40000 && mapper.map_prg(0xC000) == 0x48000, test, "first bank fixed");
+
+  mmc1_write(mapper, 0x8000, 0x00);
+  check(mapper.map_prg(0x8000) == 0x48000 && mapper.map_prg(0xC000) == 0x4C000, test, "32KB mode");
+}
+
+static void test_uxrom() {
+  const char* test = "UxROM";
+  NES_Mapper_UxROM mapper(0x20000, 0, VERTICAL);
+
+  check(mapper.map_prg(0x8000) == 0x00000 && mapper.map_prg(0xC000) == 0x1C000, test, "power up banks");
+
+  mapper.cpu_write(0x8000, 0x03);
+  check(mapper.map_prg(0x8000) == 0x0C000 && mapper.map_prg(0xBFFF) == 0x0FFFF, test, "bank at $8000");
+  check(mapper.map_prg(0xC000) == 0x1C000, test, "last bank stays at $C000");
+
+  // Any address selects, bank numbers wrap around the ROM.
+  mapper.cpu_write(0xFFFF, 0x09);
+  check(mapper.map_prg(0x8000) == 0x04000, test, "bank wraps");
+}
+
+static void test_cnrom() {
+  const char* test = "CNROM";
+  NES_Mapper_CNROM mapper(0x8000, 0x8000, VERTICAL);
+
+  check(mapper.map_chr(0x0000) == 0x0000, test, "power up bank");
+
+  mapper.cpu_write(0x8000, 0x02);
+  check(mapper.map_chr(0x0000) == 0x4000 && mapper.map_chr(0x1FFF) == 0x5FFF, test, "8KB CHR bank");
+  check(mapper.map_prg(0x8000) == 0x0000 && mapper.map_prg(0xC000) == 0x4000, test, "PRG fixed");
+
+  mapper.cpu_write(0xC123, 0x05);
+  check(mapper.map_chr(0x0000) == 0x2000, test, "bank wraps");
+}
+
+// Clocks the counter until the IRQ line goes up, 0 when it does not within the limit
+static unsigned int mmc3_scanlines_to_irq(NES_Mapper &mapper, unsigned int limit) {
+  for (unsigned int count = 1; count <= limit; count++) {
+    mapper.scanline();
+
+    if (mapper.get_irq())
+      return count;
+  }
+
+  return 0;
+}
+
+static void test_mmc3_irq() {
+  const char* test = "MMC3 IRQ";
+  NES_Mapper_MMC3 mapper(0x20000, 0x20000, VERTICAL);
+
+  check(mapper.get_irq_scanlines() == 0, test, "no IRQ while disabled");
+
+  // Latch 0 reloads to 0 and raises the line on every clock.
+  mapper.cpu_write(0xC000, 0x00);
+  mapper.cpu_write(0xC001, 0x00);
+  mapper.cpu_write(0xE001, 0x00);
+
+  check(mapper.get_irq_scanlines() == 1, test, "latch 0 predicted");
+  check(mmc3_scanlines_to_irq(mapper, 300) == 1, test, "latch 0 raised");
+  check(mapper.get_irq_scanlines() == 0, test, "nothing predicted while raised");
+
+  mapper.cpu_write(0xE000, 0x00);
+  mapper.cpu_write(0xE001, 0x00);
+  check(!mapper.get_irq(), test, "disabling acknowledges");
+  check(mapper.get_irq_scanlines() == 1 && mmc3_scanlines_to_irq(mapper, 300) == 1, test, "latch 0 again");
+
+  // Latch N with a reload pending: one clock to reload, N to count down.
+  mapper.cpu_write(0xE000, 0x00);
+  mapper.cpu_write(0xE001, 0x00);
+  mapper.cpu_write(0xC000, 0x05);
+  mapper.cpu_write(0xC001, 0x00);
+
+  check(mapper.get_irq_scanlines() == 6, test, "latch N predicted");
+  check(mmc3_scanlines_to_irq(mapper, 300) == 6, test, "latch N raised");
+
+  // Counting again from the latch after the counter reached 0.
+  mapper.cpu_write(0xE000, 0x00);
+  mapper.cpu_write(0xE001, 0x00);
+  check(mapper.get_irq_scanlines() == 6, test, "reloads from 0");
+
+  // Part way down, a new latch waits for the next reload.
+  mapper.scanline();
+  mapper.scanline();
+  mapper.scanline();
+  mapper.cpu_write(0xC000, 0x40);
+
+  check(mapper.get_irq_scanlines() == 3, test, "counts down from where it is");
+  check(mmc3_scanlines_to_irq(mapper, 300) == 3, test, "raised at 0");
+
+  // A reload written part way down starts over from the latch.
+  mapper.cpu_write(0xE000, 0x00);
+  mapper.cpu_write(0xE001, 0x00);
+  mapper.scanline();
+  mapper.scanline();
+  mapper.cpu_write(0xC001, 0x00);
+
+  check(mapper.get_irq_scanlines() == 0x41, test, "pending reload predicted");
+  check(mmc3_scanlines_to_irq(mapper, 300) == 0x41, test, "pending reload raised");
+}
+
+int main() {
+  test_mmc1_shift_register();
+  test_mmc1_prg_modes();
+  test_mmc1_surom();
+  test_uxrom();
+  test_cnrom();
+  test_mmc3_irq();
+
+  if (!failures)
+    printf("All mapper tests passed\n");
+
+  return failures;
+}
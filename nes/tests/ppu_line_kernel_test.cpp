@@ -0,0 +1,113 @@
+#include "nes.h"
+#include "nes_ppu_line_kernel.h"
+#include <cstdio>
+#include <random>
+
+using namespace NES_Emulator;
+
+/**
+ * Composes randomized scanlines with the scalar kernel and with every
+ * SIMD kernel the host supports, and checks that each one writes the
+ * same frame row. Lines mix transparent and opaque pixels on both
+ * layers, sprites in front of and behind the background, grayscale and
+ * emphasis, and start the background at every fine X offset the PPU
+ * passes in. Exits with the number of failures.
+ */
+
+static int failures = 0;
+
+static void check(bool passed, const char* test, const char* what) {
+  if (!passed) {
+    printf("FAIL %s: %s\n", test, what);
+    failures++;
+  }
+}
+
+// Palette RAM index, transparent about a third of the time
+static BYTE random_index(std::mt19937 &random) {
+  return random() % 3 ? random() & 0x1F : 0;
+}
+
+static void test_kernel(NES_PPU_Line_Kernel::instruction_set set, const char* test) {
+  NES_PPU_Line_Kernel::kernel kernel = NES_PPU_Line_Kernel::get(set);
+
+  if (!kernel) {
+    printf("SKIP %s: not supported on this host\n", test);
+    return;
+  }
+
+  NES_PPU_Line_Kernel::kernel scalar = NES_PPU_Line_Kernel::get(NES_PPU_Line_Kernel::instruction_set::scalar);
+  std::mt19937 random(0x4E45531A);
+
+  // The background line is fetched 8 pixels wide of the screen, as the PPU does.
+  BYTE background[256 + 8];
+  BYTE sprite[256];
+  BYTE sprite_behind[256];
+  BYTE palette_table[32];
+  uint16_t expected[256];
+  uint16_t output[256];
+
+  for (int pass = 0; pass < 4096; pass++) {
+    for (BYTE &pixel : background)
+      pixel = random_index(random);
+
+    for (int x = 0; x < 256; x++) {
+      sprite[x] = random_index(random);
+      sprite_behind[x] = random() & 1 ? random() | 1 : 0;
+    }
+
+    for (BYTE &color : palette_table)
+      color = random() & 0x3F;
+
+    BYTE grayscale = random() & 1 ? 0x30 : 0x3F;
+    uint16_t emphasis = (random() & 0x07) << 6;
+    int fine_x = pass & 0x07;
+
+    NES_PPU_Line_Kernel::line inputs = { background + fine_x, sprite, sprite_behind, palette_table, grayscale, emphasis, expected };
+    scalar(inputs);
+
+    inputs.output = output;
+    kernel(inputs);
+
+    if (memcmp(expected, output, sizeof(output)) != 0) {
+      check(false, test, "frame row differs from the scalar kernel");
+      return;
+    }
+  }
+
+  // One pixel of each kind, against colors worked out by hand.
+  memset(background, 0, sizeof(background));
+  memset(sprite, 0, sizeof(sprite));
+  memset(sprite_behind, 0, sizeof(sprite_behind));
+
+  for (int i = 0; i < 32; i++)
+    palette_table[i] = i + 0x20;
+
+  background[1] = 0x05;
+  background[2] = 0x06;
+  sprite[2] = 0x11;
+  sprite[3] = 0x12;
+  background[4] = 0x07;
+  sprite[4] = 0x13;
+  sprite_behind[4] = 1;
+
+  NES_PPU_Line_Kernel::line inputs = { background, sprite, sprite_behind, palette_table, 0x3F, 0x40, output };
+  kernel(inputs);
+
+  check(output[0] == (0x40 | 0x20), test, "backdrop where both layers are transparent");
+  check(output[1] == (0x40 | 0x25), test, "background");
+  check(output[2] == (0x40 | 0x31), test, "sprite in front");
+  check(output[3] == (0x40 | 0x32), test, "sprite over transparent background");
+  check(output[4] == (0x40 | 0x27), test, "sprite behind background");
+}
+
+int main() {
+  test_kernel(NES_PPU_Line_Kernel::instruction_set::scalar, "scalar kernel");
+  test_kernel(NES_PPU_Line_Kernel::instruction_set::sse41, "SSE4.1 kernel");
+  test_kernel(NES_PPU_Line_Kernel::instruction_set::avx2, "AVX2 kernel");
+
+  if (!failures)
+    printf("All line kernel tests passed\n");
+
+  return failures;
+}
@@ -0,0 +1,291 @@
+#include "nes.h"
+#include "nes_system.h"
+#include <cstdio>
+
+using namespace NES_Emulator;
+
+/**
+ * Runs small programs on the whole system and checks PPU timing against
+ * where the hardware puts it. The sprite 0 hit is checked with PPUMASK
+ * written between the end of vblank and the hit, on both the catch-up and
+ * the lockstep PPU. A split screen scroller then runs on both, which have
+ * to agree on every frame and on where the PPU is at every $2005 write.
+ * Exits with the number of failures.
+ */
+
+static int failures = 0;
+
+static void check(bool passed, const char* test, const char* what) {
+  if (!passed) {
+    printf("FAIL %s: %s\n", test, what);
+    failures++;
+  }
+}
+
+// 16KB NROM image with 8KB CHR ROM: tile 1 is solid, tile 2 has only its top left pixel set,
+// tiles from 3 on have a pattern of their own
+static std::string write_rom(const char* name, const std::vector<BYTE> &program) {
+  std::vector<BYTE> prg(0x4000, 0xEA);
+  std::vector<BYTE> chr(0x2000, 0x00);
+
+  std::copy(program.begin(), program.end(), prg.begin());
+
+  // Reset vector, $FFFC mirrors $BFFC
+  prg[0x3FFC] = 0x00;
+  prg[0x3FFD] = 0x80;
+
+  for (int row = 0; row < 8; row++)
+    chr[0x0010 + row] = 0xFF;
+
+  chr[0x0020] = 0x80;
+
+  for (int i = 0x0030; i < 0x2000; i++)
+    chr[i] = (i >> 4) * 7 ^ (i & 0x0F) * 29;
+
+  const BYTE header[16] = { 'N', 'E', 'S', 0x1A, 1, 1 };
+  std::string path = std::string(name) + ".nes";
+  std::ofstream ofs(path, std::ofstream::binary);
+
+  ofs.write((const char*)header, sizeof(header));
+  ofs.write((const char*)prg.data(), prg.size());
+  ofs.write((const char*)chr.data(), chr.size());
+
+  return path;
+}
+
+// PPU register writes as the system reports them
+struct ppu_write {
+  address_t address;
+  BYTE val;
+  master_cycle_t position;
+};
+
+static void record_ppu_write(void* context, address_t address, BYTE val, master_cycle_t position) {
+  ((std::vector<ppu_write>*)context)->push_back({ (address_t)(address & 0x0007), val, position });
+}
+
+// Sprite 0 at X 100 on line 100, over a solid background
+static const master_cycle_t SPRITE_ZERO_HIT_DOT = 100 * NES_PPU::DOTS_PER_SCANLINE + 101;
+
+static void test_sprite_zero_hit_after_mask_write(nes_ppu_sync sync, const char* test) {
+  std::string path = write_rom("ppu_test_sprite_zero", {
+    0x78,             // SEI
+    0xA9, 0x00,       // LDA #$00
+    0x8D, 0x00, 0x20, // STA $2000
+    0x8D, 0x01, 0x20, // STA $2001
+    0x2C, 0x02, 0x20, // BIT $2002     wait for vblank
+    0x10, 0xFB,       // BPL $8009
+    0xA9, 0x20,       // LDA #$20
+    0x8D, 0x06, 0x20, // STA $2006
+    0xA9, 0x00,       // LDA #$00
+    0x8D, 0x06, 0x20, // STA $2006
+    0xA9, 0x01,       // LDA #$01      nametable 0 filled with the solid tile
+    0xA0, 0x04,       // LDY #$04
+    0xA2, 0x00,       // LDX #$00
+    0x8D, 0x07, 0x20, // STA $2007
+    0xE8,             // INX
+    0xD0, 0xFA,       // BNE $801E
+    0x88,             // DEY
+    0xD0, 0xF7,       // BNE $801E
+    0xA9, 0x00,       // LDA #$00
+    0x8D, 0x03, 0x20, // STA $2003
+    0xA9, 0x63,       // LDA #$63      sprite 0: Y 99, tile 2, X 100
+    0x8D, 0x04, 0x20, // STA $2004
+    0xA9, 0x02,       // LDA #$02
+    0x8D, 0x04, 0x20, // STA $2004
+    0xA9, 0x00,       // LDA #$00
+    0x8D, 0x04, 0x20, // STA $2004
+    0xA9, 0x64,       // LDA #$64
+    0x8D, 0x04, 0x20, // STA $2004
+    0xA9, 0x00,       // LDA #$00
+    0x8D, 0x05, 0x20, // STA $2005
+    0x8D, 0x05, 0x20, // STA $2005
+    0xA2, 0x1E,       // LDX #$1E
+    0xA0, 0x00,       // LDY #$00
+    0x2C, 0x02, 0x20, // BIT $2002     wait for vblank
+    0x10, 0xFB,       // BPL $804C
+    0x2C, 0x02, 0x20, // BIT $2002     wait for the flag to clear at the end of vblank
+    0x70, 0xFB,       // BVS $8051
+    0x8C, 0x01, 0x20, // STY $2001     rendering off and back on
+    0x8E, 0x01, 0x20, // STX $2001
+    0x8E, 0x01, 0x20, // STX $2001     rewritten while polling for the hit
+    0x2C, 0x02, 0x20, // BIT $2002
+    0x50, 0xF8,       // BVC $805C
+    0x8C, 0x03, 0x20, // STY $2003     the program saw the hit
+    0x4C, 0x4C, 0x80, // JMP $804C
+  });
+
+  NES_System system(nes_cpu_core_table, sync);
+  NES_Cartridge cartridge(path);
+  std::vector<ppu_write> writes;
+
+  system.insert_cartridge(&cartridge);
+  system.set_ppu_write_hook(record_ppu_write, &writes);
+  system.reset();
+
+  for (int frame = 0; frame < 10; frame++)
+    system.run_frame();
+
+  // Setup takes the first two frames, from then on every frame has its hit.
+  std::vector<master_cycle_t> seen;
+
+  for (size_t i = 0; i < writes.size(); i++) {
+    if (writes[i].address == 0x0003 && writes[i].position >= 2 * NES_PPU::DOTS_PER_FRAME)
+      seen.push_back(writes[i].position);
+  }
+
+  check(seen.size() == 8, test, "one hit a frame");
+
+  for (size_t i = 0; i < seen.size(); i++) {
+    master_cycle_t hit = seen[i] / NES_PPU::DOTS_PER_FRAME * NES_PPU::DOTS_PER_FRAME + SPRITE_ZERO_HIT_DOT;
+
+    // Seen within one pass of the polling loop, 11 CPU cycles, and the write after it.
+    check(seen[i] > hit && seen[i] <= hit + 15 * 3, test, "hit seen at its dot");
+  }
+
+  system.set_ppu_write_hook(nullptr, nullptr);
+  std::remove(path.c_str());
+}
+
+// Everything a run shows, frame by frame
+struct frame_trace {
+  std::vector<std::vector<uint16_t>> frames;
+  std::vector<ppu_write> scroll_writes;
+};
+
+static frame_trace run_scroller(const std::string &path, nes_cpu_core core, nes_ppu_sync sync, int frames) {
+  NES_System system(core, sync);
+  NES_Cartridge cartridge(path);
+  std::vector<ppu_write> writes;
+  frame_trace trace;
+
+  system.insert_cartridge(&cartridge);
+  system.set_ppu_write_hook(record_ppu_write, &writes);
+  system.reset();
+
+  for (int frame = 0; frame < frames; frame++) {
+    system.run_frame();
+
+    const uint16_t* pixels = system.get_screen()->get_pixels();
+    trace.frames.emplace_back(pixels, pixels + NES_Frame::WIDTH * NES_Frame::HEIGHT);
+  }
+
+  for (const ppu_write &write : writes) {
+    if (write.address == 0x0005)
+      trace.scroll_writes.push_back(write);
+  }
+
+  system.set_ppu_write_hook(nullptr, nullptr);
+  return trace;
+}
+
+static void test_catch_up_matches_lockstep() {
+  std::string path = write_rom("ppu_test_split", {
+    0x78,             // SEI
+    0xA9, 0x00,       // LDA #$00
+    0x8D, 0x00, 0x20, // STA $2000
+    0x8D, 0x01, 0x20, // STA $2001
+    0x2C, 0x02, 0x20, // BIT $2002     wait for vblank
+    0x10, 0xFB,       // BPL $8009
+    0xA9, 0x20,       // LDA #$20
+    0x8D, 0x06, 0x20, // STA $2006
+    0xA9, 0x00,       // LDA #$00
+    0x8D, 0x06, 0x20, // STA $2006
+    0xA0, 0x04,       // LDY #$04      nametable and attributes from $2000
+    0xA2, 0x00,       // LDX #$00
+    0x8E, 0x07, 0x20, // STX $2007
+    0xE8,             // INX
+    0xD0, 0xFA,       // BNE $801C
+    0x88,             // DEY
+    0xD0, 0xF7,       // BNE $801C
+    0xA9, 0x3F,       // LDA #$3F
+    0x8D, 0x06, 0x20, // STA $2006
+    0xA9, 0x00,       // LDA #$00
+    0x8D, 0x06, 0x20, // STA $2006
+    0xA2, 0x00,       // LDX #$00
+    0x8A,             // TXA           palette entry X is colour X * 2
+    0x0A,             // ASL A
+    0x8D, 0x07, 0x20, // STA $2007
+    0xE8,             // INX
+    0xE0, 0x20,       // CPX #$20
+    0xD0, 0xF6,       // BNE $8031
+    0xA9, 0x00,       // LDA #$00
+    0x8D, 0x00, 0x20, // STA $2000     back to nametable 0 after $2006 moved it
+    0x8D, 0x03, 0x20, // STA $2003
+    0xA9, 0x63,       // LDA #$63      sprite 0: Y 99, tile 1, X 100
+    0x8D, 0x04, 0x20, // STA $2004
+    0xA9, 0x01,       // LDA #$01
+    0x8D, 0x04, 0x20, // STA $2004
+    0xA9, 0x00,       // LDA #$00
+    0x8D, 0x04, 0x20, // STA $2004
+    0xA9, 0x64,       // LDA #$64
+    0x8D, 0x04, 0x20, // STA $2004
+    0xA9, 0x1E,       // LDA #$1E
+    0x8D, 0x01, 0x20, // STA $2001
+    0x2C, 0x02, 0x20, // BIT $2002     wait for vblank
+    0x10, 0xFB,       // BPL $805C
+    0xE6, 0x10,       // INC $10
+    0xA9, 0x00,       // LDA #$00      no scroll above the split
+    0x8D, 0x05, 0x20, // STA $2005
+    0x8D, 0x05, 0x20, // STA $2005
+    0x2C, 0x02, 0x20, // BIT $2002     wait for the flag to clear at the end of vblank
+    0x70, 0xFB,       // BVS $806B
+    0x2C, 0x02, 0x20, // BIT $2002     wait for the hit
+    0x50, 0xFB,       // BVC $8070
+    0xA2, 0x06,       // LDX #$06      six scroll changes, about two lines apart
+    0xA0, 0x28,       // LDY #$28
+    0x88,             // DEY
+    0xD0, 0xFD,       // BNE $8079
+    0x8A,             // TXA
+    0x65, 0x10,       // ADC $10
+    0x8D, 0x05, 0x20, // STA $2005
+    0x8D, 0x05, 0x20, // STA $2005
+    0xCA,             // DEX
+    0xD0, 0xEF,       // BNE $8077
+    0x4C, 0x5C, 0x80, // JMP $805C
+  });
+
+  const int FRAMES = 8;
+  frame_trace lockstep = run_scroller(path, nes_cpu_core_table, nes_ppu_sync_lockstep, FRAMES);
+
+  // The split has to happen for the comparison to cover it, on every frame after the two setup takes.
+  size_t split_writes = 0;
+
+  for (const ppu_write &write : lockstep.scroll_writes) {
+    if (write.position % NES_PPU::DOTS_PER_FRAME < 240 * NES_PPU::DOTS_PER_SCANLINE)
+      split_writes++;
+  }
+
+  check(split_writes == (FRAMES - 2) * 12, "split scroller", "scroll written mid-frame");
+
+  const nes_cpu_core cores[] = { nes_cpu_core_table, nes_cpu_core_jit };
+  const char* names[] = { "catch-up matches lockstep, table core", "catch-up matches lockstep, JIT core" };
+
+  for (int i = 0; i < 2; i++) {
+    frame_trace catch_up = run_scroller(path, cores[i], nes_ppu_sync_catch_up, FRAMES);
+    bool same_writes = catch_up.scroll_writes.size() == lockstep.scroll_writes.size();
+
+    for (size_t w = 0; same_writes && w < lockstep.scroll_writes.size(); w++) {
+      same_writes = catch_up.scroll_writes[w].val == lockstep.scroll_writes[w].val &&
+        catch_up.scroll_writes[w].position == lockstep.scroll_writes[w].position;
+    }
+
+    check(same_writes, names[i], "PPU position at every $2005 write");
+
+    for (int frame = 0; frame < FRAMES; frame++)
+      check(catch_up.frames[frame] == lockstep.frames[frame], names[i], "frame");
+  }
+
+  std::remove(path.c_str());
+}
+
+int main() {
+  test_sprite_zero_hit_after_mask_write(nes_ppu_sync_catch_up, "sprite 0 hit after PPUMASK write, catch-up");
+  test_sprite_zero_hit_after_mask_write(nes_ppu_sync_lockstep, "sprite 0 hit after PPUMASK write, lockstep");
+  test_catch_up_matches_lockstep();
+
+  if (!failures)
+    printf("All PPU tests passed\n");
+
+  return failures;
+}
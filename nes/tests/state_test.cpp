@@ -0,0 +1,208 @@
+#include "nes.h"
+#include "nes_system.h"
+#include <cstdio>
+
+using namespace NES_Emulator;
+
+/**
+ * Saves a state part way through a frame, runs on, loads the state and
+ * runs the same stretch again, checking that the frame and the CPU
+ * registers come out the same both times. Headers from another version,
+ * another ROM, or cut short are rejected and leave the system as it was.
+ * Exits with the number of failures.
+ */
+
+static int failures = 0;
+
+static void check(bool passed, const char* test, const char* what) {
+  if (!passed) {
+    printf("FAIL %s: %s\n", test, what);
+    failures++;
+  }
+}
+
+// 16KB NROM image with 8KB CHR ROM, a different pattern in every tile
+static std::string write_rom(const char* name, const std::vector<BYTE> &program) {
+  std::vector<BYTE> prg(0x4000, 0xEA);
+  std::vector<BYTE> chr(0x2000);
+
+  std::copy(program.begin(), program.end(), prg.begin());
+
+  // Reset vector, $FFFC mirrors $BFFC
+  prg[0x3FFC] = 0x00;
+  prg[0x3FFD] = 0x80;
+
+  for (int i = 0; i < 0x2000; i++)
+    chr[i] = (i >> 4) * 7 ^ (i & 0x0F) * 29;
+
+  const BYTE header[16] = { 'N', 'E', 'S', 0x1A, 1, 1 };
+  std::string path = std::string(name) + ".nes";
+  std::ofstream ofs(path, std::ofstream::binary);
+
+  ofs.write((const char*)header, sizeof(header));
+  ofs.write((const char*)prg.data(), prg.size());
+  ofs.write((const char*)chr.data(), chr.size());
+
+  return path;
+}
+
+// Fills the nametable and palette, then scrolls a little further every frame
+static const std::vector<BYTE> SCROLLER = {
+  0x78,             // SEI
+  0xA9, 0x00,       // LDA #$00
+  0x8D, 0x00, 0x20, // STA $2000
+  0x8D, 0x01, 0x20, // STA $2001
+  0x2C, 0x02, 0x20, // BIT $2002     wait for vblank
+  0x10, 0xFB,       // BPL $8009
+  0xA9, 0x20,       // LDA #$20
+  0x8D, 0x06, 0x20, // STA $2006
+  0xA9, 0x00,       // LDA #$00
+  0x8D, 0x06, 0x20, // STA $2006
+  0xA0, 0x04,       // LDY #$04      nametable and attributes from $2000
+  0xA2, 0x00,       // LDX #$00
+  0x8E, 0x07, 0x20, // STX $2007
+  0xE8,             // INX
+  0xD0, 0xFA,       // BNE $801C
+  0x88,             // DEY
+  0xD0, 0xF7,       // BNE $801C
+  0xA9, 0x3F,       // LDA #$3F
+  0x8D, 0x06, 0x20, // STA $2006
+  0xA9, 0x00,       // LDA #$00
+  0x8D, 0x06, 0x20, // STA $2006
+  0xA2, 0x00,       // LDX #$00
+  0x8A,             // TXA           palette entry X is colour X * 2
+  0x0A,             // ASL A
+  0x8D, 0x07, 0x20, // STA $2007
+  0xE8,             // INX
+  0xE0, 0x20,       // CPX #$20
+  0xD0, 0xF6,       // BNE $8031
+  0xA9, 0x1E,       // LDA #$1E
+  0x8D, 0x01, 0x20, // STA $2001
+  0x2C, 0x02, 0x20, // BIT $2002     wait for vblank
+  0x10, 0xFB,       // BPL $8040
+  0xE6, 0x10,       // INC $10
+  0xA5, 0x10,       // LDA $10
+  0x8D, 0x05, 0x20, // STA $2005
+  0x0A,             // ASL A
+  0x8D, 0x05, 0x20, // STA $2005
+  0xA6, 0x10,       // LDX $10
+  0x4C, 0x40, 0x80, // JMP $8040
+};
+
+// What a run leaves behind, to compare against the same run after a load
+struct snapshot {
+  std::vector<uint16_t> pixels;
+  BYTE a, x, y, p, sp;
+  address_t pc;
+  master_cycle_t cycle;
+
+  snapshot(NES_System &system) {
+    const uint16_t* frame = system.get_screen()->get_pixels();
+    pixels.assign(frame, frame + NES_Frame::WIDTH * NES_Frame::HEIGHT);
+
+    NES_CPU* cpu = system.get_cpu();
+    a = cpu->A();
+    x = cpu->X();
+    y = cpu->Y();
+    p = cpu->P();
+    sp = cpu->SP();
+    pc = cpu->PC();
+    cycle = system.get_master_cycle();
+  }
+
+  bool same_frame(const snapshot &other) const {
+    return pixels == other.pixels;
+  }
+
+  bool same_registers(const snapshot &other) const {
+    return a == other.a && x == other.x && y == other.y && p == other.p && sp == other.sp && pc == other.pc &&
+      cycle == other.cycle;
+  }
+};
+
+static void test_round_trip(nes_cpu_core core, nes_ppu_sync sync, const char* test) {
+  std::string path = write_rom("state_test_round_trip", SCROLLER);
+  NES_System system(core, sync);
+  NES_Cartridge cartridge(path);
+
+  system.insert_cartridge(&cartridge);
+  system.reset();
+
+  // Saved part way through a line, with the scroll already moving.
+  system.run_until(5 * NES_PPU::DOTS_PER_FRAME + 123 * NES_PPU::DOTS_PER_SCANLINE + 77);
+
+  std::vector<BYTE> state(system.get_state_size());
+  check(system.save_state(state.data(), state.size()), test, "save");
+
+  master_cycle_t end = system.get_master_cycle() + 10 * NES_PPU::DOTS_PER_FRAME;
+  system.run_until(end);
+  snapshot first(system);
+
+  check(system.load_state(state.data(), state.size()), test, "load");
+  system.run_until(end);
+  snapshot second(system);
+
+  check(first.same_frame(second), test, "frame");
+  check(first.same_registers(second), test, "registers");
+
+  // The frame has to have moved on, or the comparison shows nothing.
+  check(first.pixels != std::vector<uint16_t>(first.pixels.size(), first.pixels[0]), test, "frame drawn");
+
+  std::remove(path.c_str());
+}
+
+static void test_rejected_headers() {
+  const char* test = "rejected headers";
+  std::string path = write_rom("state_test_headers", SCROLLER);
+  NES_System system;
+  NES_Cartridge cartridge(path);
+
+  system.insert_cartridge(&cartridge);
+  system.reset();
+  system.run_until(3 * NES_PPU::DOTS_PER_FRAME + 1000);
+
+  std::vector<BYTE> state(system.get_state_size());
+  system.save_state(state.data(), state.size());
+  system.run_frame();
+
+  std::vector<BYTE> before(state.size());
+  system.save_state(before.data(), before.size());
+
+  // Header layout: magic, version, total size, ROM hash.
+  std::vector<BYTE> magic = state;
+  magic[0] ^= 0xFF;
+  check(!system.load_state(magic.data(), magic.size()), test, "bad magic");
+
+  std::vector<BYTE> version = state;
+  version[4]++;
+  check(!system.load_state(version.data(), version.size()), test, "bad version");
+
+  std::vector<BYTE> rom = state;
+  rom[12] ^= 0x01;
+  check(!system.load_state(rom.data(), rom.size()), test, "wrong ROM hash");
+
+  check(!system.load_state(state.data(), state.size() - 1), test, "truncated");
+  check(!system.load_state(state.data(), 19), test, "truncated header");
+  check(!system.save_state(magic.data(), state.size() - 1), test, "short save buffer");
+
+  // None of them changed anything.
+  std::vector<BYTE> after(state.size());
+  system.save_state(after.data(), after.size());
+  check(before == after, test, "system untouched");
+
+  check(system.load_state(state.data(), state.size()), test, "intact state still loads");
+
+  std::remove(path.c_str());
+}
+
+int main() {
+  test_round_trip(nes_cpu_core_table, nes_ppu_sync_catch_up, "round trip, table core");
+  test_round_trip(nes_cpu_core_jit, nes_ppu_sync_catch_up, "round trip, JIT core");
+  test_round_trip(nes_cpu_core_table, nes_ppu_sync_lockstep, "round trip, lockstep");
+  test_rejected_headers();
+
+  if (!failures)
+    printf("All save state tests passed\n");
+
+  return failures;
+}